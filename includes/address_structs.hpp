@@ -8,6 +8,7 @@ typedef struct CacheConfig {
     int numberOfIndexBits;
     int numberOfTagBits;
     int numberOfOffsetBits;
+    int numberOfSectorOffsetBits; // equals numberOfOffsetBits if lines aren't sectored
 } CacheConfig;
 
 struct CacheAddress {
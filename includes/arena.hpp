@@ -0,0 +1,45 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+#define ARENA_ALIGNMENT 64
+
+// One contiguous, 64 Byte aligned region for the line storage and metadata of a cache, optionally
+// backed by huge pages. The size is fixed at construction, memory is handed out front to back and
+// released at once, so objects placed in the arena must not need their destructors to run.
+class Arena {
+private:
+    uint8_t* base;
+    size_t capacity;
+    size_t used;
+    bool mapped;
+    size_t mappedLength; // capacity rounded up to whole huge pages for an explicit huge page mapping
+
+public:
+    Arena(size_t capacity, bool hugePages);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Exits if the arena is exhausted, every owner sizes its arena for all blocks it carves out
+    void* allocate(size_t size, size_t alignment = ARENA_ALIGNMENT);
+
+    // Default-constructed array of count objects
+    template <typename T>
+    T* allocate_array(size_t count) {
+        T* array = static_cast<T*>(allocate(count * sizeof(T), alignof(T) > ARENA_ALIGNMENT ? alignof(T) : ARENA_ALIGNMENT));
+        for (size_t i = 0; i < count; i++) {
+            new (&array[i]) T();
+        }
+        return array;
+    }
+
+    // Space for count blocks of size Byte including the alignment padding of allocate()
+    static size_t size_for(size_t count, size_t size) { return count * size + ARENA_ALIGNMENT; }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+
+#include <stddef.h>
+
+#include "io_structs.hpp"
+
+typedef enum AutotuneObjective {
+    AUTOTUNE_NONE = 0,
+    AUTOTUNE_CYCLES,
+    AUTOTUNE_AMAT
+} AutotuneObjective;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Searches organizations, cachelines and cacheline sizes within gateBudget primitive gates for the lowest
+// cycles or AMAT on the requests. Every configuration is estimated with a functional run of the cache
+// without SystemC, the Pareto front and the best confirmCount estimates are then simulated in detail.
+// Both phases run in up to workers forked processes, 0 for one per core. Prints the Pareto front of
+// gates vs the objective and returns EXIT_FAILURE if no configuration fits the budget.
+int run_autotune(int cycles, unsigned cacheLatency, int memoryLatency, size_t numRequests, Request requests[],
+                 const SimulationOptions* options, AutotuneObjective objective, size_t gateBudget,
+                 unsigned confirmCount, unsigned workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,17 +3,99 @@
 
 #include "address_structs.hpp"
 #include "io_structs.hpp"
+#include "checkpoint.hpp"
 #include <cstdint>
 
+// What the last read/write did besides counting a hit or miss, consumed by the timing model of CACHE_MODULE
+struct AccessInfo {
+    bool prefetchedHit = false;  // hit a line brought in by a prefetch and not used since
+    bool victimHit = false;      // missed the cache but was served by the victim buffer
+    bool sectorMiss = false;     // tag matched but the sector wasn't valid yet
+    unsigned sectorsFetched = 0; // sectors read from the main memory
+    bool splitAccess = false;    // the access spanned more than one line
+};
+
+// CAT-style way partitioning of the 4-way cache: a stream hits in every way but only fills the ways in
+// its mask. A set holds one way per tag bit, bit i of a mask selects way i of every set. A line is owned
+// by the stream that filled it last.
+struct WayPartition {
+    unsigned stream = 0;                 // stream of the current access, set before every access
+    uint32_t wayMasks[MAX_STREAMS] = {}; // 0 for all ways
+    size_t linesOwned[MAX_STREAMS] = {};
+};
+
+// Line the last lookup left as the most recently used of its set. Another access inside its valid sectors
+// hits without changing the replacement state, so a run of such accesses can skip the lookup altogether.
+// Every lookup remembers its line, prefetches and checkpoint loads forget it.
+struct RepeatLine {
+    bool valid = false;
+    uint32_t lineNumber = 0;
+    uint8_t* data = nullptr;
+    uint64_t validSectors = 0;
+
+    void remember(uint32_t address, uint8_t* lineData, uint64_t sectors, CacheConfig cacheConfig) {
+        valid = true;
+        lineNumber = address >> cacheConfig.numberOfOffsetBits;
+        data = lineData;
+        validSectors = sectors;
+    }
+    void forget() { valid = false; }
+};
+
 class CacheBase {
 public:
+    AccessInfo lastAccess;
+    WayPartition partition; // only the 4-way cache partitions its ways
+    RepeatLine repeatLine;
+
     virtual ~CacheBase() = default;
 
     virtual uint32_t read_from_cache(uint32_t address, CacheConfig cacheConfig, Result &result) = 0;
     
     virtual void write_to_cache(uint32_t address, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) = 0;
 
+    // Fill the line containing address without counting a hit or miss, returns false if it is already cached
+    virtual bool prefetch(uint32_t address, CacheConfig cacheConfig) = 0;
+
+    // Tags, replacement state, valid bits and line data for checkpoints, load returns false on a truncated checkpoint
+    virtual void save_state(CheckpointWriter &writer, CacheConfig cacheConfig) = 0;
+    virtual bool load_state(CheckpointReader &reader, CacheConfig cacheConfig) = 0;
+
+    // Look up the size bytes at address, which must not cross a line, and return the data of their line
+    virtual uint8_t* access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) = 0;
+
+    // Run-length fast path: true if size bytes at address stay inside the valid sectors of the repeat line
+    bool repeats_line(uint32_t address, uint32_t size, CacheConfig cacheConfig) const {
+        uint32_t offset = address & ((1u << cacheConfig.numberOfOffsetBits) - 1);
+        if (!repeatLine.valid || (address >> cacheConfig.numberOfOffsetBits) != repeatLine.lineNumber ||
+            offset + size > (1u << cacheConfig.numberOfOffsetBits)) {
+            return false;
+        }
+        uint64_t sectorMask = sector_mask(offset, size, cacheConfig);
+        return (repeatLine.validSectors & sectorMask) == sectorMask;
+    }
+
+    // Count a run of accesses to the repeat line as hits at once
+    void repeat_hits(size_t count, Result &result) {
+        lastAccess = AccessInfo();
+        result.hits += count;
+    }
+
+    // Wide accesses of any width, an access crossing lines is split but counts as a single hit or miss
+    void read_span(uint32_t address, uint32_t size, uint8_t* dataToRead, CacheConfig cacheConfig, Result &result);
+    void write_span(uint32_t address, uint32_t size, const uint8_t* dataToWrite, CacheConfig cacheConfig, Result &result);
+
     static uint32_t merge_data_to_uint32(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t data4);
+
+    // Valid-bit mask of the sectors touched by size bytes at offset, and of all sectors of a line
+    static uint64_t sector_mask(uint32_t offset, uint32_t size, CacheConfig cacheConfig);
+    static uint64_t all_sectors(CacheConfig cacheConfig);
+
+    // Read the sectors selected by mask of the line starting at lineAddress from the main memory
+    static unsigned fetch_sectors(uint8_t* lineData, uint32_t lineAddress, uint64_t mask, CacheConfig cacheConfig);
+
+private:
+    void access_span(uint32_t address, uint32_t size, uint8_t* data, bool write, CacheConfig cacheConfig, Result &result);
 };
 
 #endif
@@ -2,16 +2,32 @@
 #define CACHEMODULE_HPP
 
 #include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_target_socket.h>
+#include <tlm_utils/simple_initiator_socket.h>
 #include <iostream>
 #include <cstdint>
+#include <vector>
+#include <unordered_map>
 
 #include "direct_mapped_cache.hpp"
 #include "four_way_lru_cache.hpp"
+#include "fully_associative_cache.hpp"
 #include "main_memory.hpp"
 #include "address_structs.hpp"
 #include "io_structs.hpp"
 #include "main_memory_global.hpp"
 #include "cache_base.hpp"
+#include "prefetcher.hpp"
+#include "mshr.hpp"
+#include "store_buffer.hpp"
+#include "checkpoint.hpp"
+#include "dram.hpp"
+#include "memory_bus.hpp"
+#include "mmu.hpp"
+#include "tlm_memory.hpp"
+#include "tlm_initiator.hpp"
+#include "latency_histogram.hpp"
 #define CACHE_ADDRESS_LENGTH 16
 
 using namespace std;
@@ -21,41 +37,205 @@ extern "C" Result run_simulation(int cycles, bool directMapped,  unsigned cacheL
                         unsigned cacheLatency, int memoryLatency, size_t numRequests, 
                         Request requests[], const char* tracefile);
 
+extern "C" Result run_simulation_with_options(int cycles, bool directMapped, unsigned cacheLines, unsigned cacheLineSize,
+                        unsigned cacheLatency, int memoryLatency, size_t numRequests,
+                        Request requests[], const char* tracefile,
+                        const SimulationOptions* options, SimulationStatistics* statistics);
+
 extern MainMemory* main_memory;
 
+// Index, offset and tag bits of a cache organization, sectorSize 0 if the lines aren't sectored
+CacheConfig cache_config(unsigned cacheLines, unsigned cacheLineSize, int directMapped, bool fullyAssociative, unsigned sectorSize);
+
+// Line storage of a cache organization, the victim buffer only exists for the direct-mapped cache
+CacheBase* create_cache(unsigned cacheLines, CacheConfig cacheConfig, int directMapped, bool fullyAssociative,
+                        unsigned victimEntries, SimulationStatistics* statistics, bool hugePages);
+
+// Primitive gates CACHE_MODULE reports for a configuration, including the hardware the options add
+uint32_t primitive_gate_count(int directMapped, bool fullyAssociative, unsigned cacheLines, unsigned cacheLineSize,
+                              const SimulationOptions* options);
+
+// Entry of the input request queue, stamped with the cycle in which the core issued it
+struct QueuedRequest {
+    size_t index;
+    Request request;
+    size_t issueCycle;
+};
+
+inline ostream& operator<<(ostream& os, const QueuedRequest& queuedRequest) {
+    return os << "#" << queuedRequest.index << "@" << queuedRequest.issueCycle;
+}
+
+// Latency stamps of a request processed through the request queue
+struct RequestTiming {
+    size_t issueCycle;
+    size_t startCycle;
+    size_t completeCycle;
+    uint32_t data;
+};
+
 SC_MODULE(CACHE_MODULE) {
     sc_in<bool> clk;
     sc_in<int> requestWE;
     sc_in<uint32_t> requestAddr;
     sc_in<uint32_t> requestData;
+    sc_in<unsigned> requestSize;
+    sc_in<int> requestFetch;
+    sc_in<unsigned> requestStream;
 
     sc_out<size_t> resultCycles;
     sc_out<size_t> resultHits;
     sc_out<size_t> resultMisses;
     sc_out<size_t> resultPrimitiveGateCount;
 
+    // Loosely-timed interface: requests arrive through targetSocket with annotated delays, misses ask the
+    // memory behind memorySocket for their latency, through its DMI pointer once it has granted one
+    tlm_utils::simple_target_socket<CACHE_MODULE> targetSocket;
+    tlm_utils::simple_target_socket<CACHE_MODULE> fetchTargetSocket;
+    tlm_utils::simple_initiator_socket<CACHE_MODULE> memorySocket;
+    tlm::tlm_dmi memoryDmi;
+    bool memoryDmiValid;
+    vector<uint8_t> lineBuffer;
+
     sc_signal<int> data;
     sc_signal<bool> waitForCacheLatency;
     sc_signal<bool> waitForMemoryLatency;
     sc_signal<bool> requestsExceedCycles;
 
+    // Queued mode (issueWidth > 0): the core pushes requests into the queue instead of the request ports
+    sc_fifo<QueuedRequest> requestQueue;
+    vector<RequestTiming> requestTimings;
+    unsigned issueWidth;
+    unsigned cachePorts;
+    size_t portsBlockedUntil;
+    size_t lastCompleteCycle;
+    size_t processedRequests;
+
+    // Blocking mode as a clocked state machine: IDLE takes the request on the ports, TAG counts the cache
+    // latency down and accesses the cache, MEM_WAIT counts the memory penalty down and RESPOND drives the
+    // data and completes the request in the same edge
+    enum FsmState { IDLE, TAG, MEM_WAIT, RESPOND };
+    FsmState fsmState;
+    unsigned tagCounter;
+    unsigned memoryCounter;
+    uint32_t fsmDataRead;
+    int fsmEdges;
+    size_t fsmStartCycle;
+    bool fsmMiss;
+
     CacheBase* cache; 
+    Prefetcher* prefetcher;
+    MissStatusHoldingRegisters* mshrs;
+    DramController* dram;
+    MemoryBus* bus;
+    MMU* mmu;
+    StoreBuffer* storeBuffer;
+    unsigned translationCycles; // cycles the translation of the current request took
+    uint32_t translatedAddress; // physical address of the current request, the memory and the MSHRs see this one
+    bool functionalWarming; // walk loads of functional accesses don't occupy the DRAM, the bus or the MSHRs
+    unsigned accessSize; // size of the current request in Byte
+    bool bufferedStore; // the current request is a store that retires into the store buffer
+    unordered_map<uint32_t, size_t> pendingFills; // line -> arrival of a write-allocate fill nobody waited for
     CacheConfig cacheConfig;
+
+    // Split instruction cache, nullptr if fetches are served by the (unified) data cache
+    CacheBase* instructionCache;
+    CacheConfig instructionConfig;
+    unsigned instructionLines;
+    unsigned instructionLineSize;
+    unsigned instructionLatency;
+    bool fetchAccess; // the current request went to the instruction cache
+    bool requestStarting;
     Result resultTemp;
     int cycles;
     int directMapped;
+    bool fullyAssociative;
     unsigned cacheLines;
     unsigned cacheLineSize;
     unsigned cacheLatency;
     unsigned memoryLatency;
+    unsigned victimLatency;
+    unsigned sectorsPerLine;
+    unsigned victimEntries;
     int numRequests;
     uint32_t totalGates;
+    SimulationStatistics* statistics;
 
     SC_CTOR(CACHE_MODULE);
     CACHE_MODULE(sc_module_name name, int cycles, int directMapped, unsigned cacheLines, unsigned cacheLineSize,
-                unsigned cacheLatency, unsigned memoryLatency, int numRequests);
+                unsigned cacheLatency, unsigned memoryLatency, int numRequests,
+                const SimulationOptions* options, SimulationStatistics* statistics);
+    ~CACHE_MODULE();
 
     void update();  
+
+    // Same timing and results as update(), evaluated once per rising clock edge without delta cycles
+    void update_fsm();
+
+    // Accepts up to cachePorts requests per cycle from the request queue, misses overlap if MSHRs are configured
+    void update_queued();
+
+    // Push a request into the request queue, returns false if the queue is full
+    bool enqueue(size_t index, const Request &request);
+
+    // True once every request pushed so far has completed
+    bool idle();
+
+    // Read or write size bytes at address in cycle and return the (first 4 bytes of the) data read
+    uint32_t access(uint32_t address, uint32_t dataToWrite, unsigned size, bool write, size_t cycle, bool fetch = false,
+                    unsigned stream = 0);
+
+    // Per-stream hits and misses of the access that started at these counts, and the lines every stream owns
+    void count_stream(unsigned stream, size_t currentHits, size_t currentMisses);
+
+    // Tag latency of a request, instruction fetches see the latency of the instruction cache and
+    // stores retire into the store buffer without one
+    unsigned tag_latency(bool fetch, bool write);
+
+    // Read into or write from bytes, size bytes at address
+    void access_bytes(uint32_t address, uint8_t* bytes, unsigned size, bool write);
+
+    // Blocking transport of the target socket, the delay grows by the cycles the blocking model needs
+    void b_transport(tlm::tlm_generic_payload &transaction, sc_time &delay);
+    void b_transport_fetch(tlm::tlm_generic_payload &transaction, sc_time &delay);
+    void transport(tlm::tlm_generic_payload &transaction, sc_time &delay, bool fetch);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 startAddress, sc_dt::uint64 endAddress);
+
+    // Latency of a line fill as reported by the memory behind memorySocket
+    unsigned memory_latency(uint32_t address);
+
+    // Functional warming for the sampled mode: updates cache contents and hit/miss counts without timing
+    uint32_t functional_access(const Request &request);
+
+    // Cycles the current request accessed in cycle has to wait for the main memory after the cache access,
+    // writeBytes is the write-through data of a write request. A buffered store only waits for room in the
+    // store buffer, a load miss whose bytes are all buffered is forwarded from it.
+    unsigned memory_penalty(uint32_t address, bool miss, unsigned memoryLatency, uint32_t writeBytes, size_t cycle);
+
+    // Latency of fetching bytes at address through the DRAM model and the memory bus if configured
+    unsigned memory_fill(uint32_t address, uint32_t bytes, unsigned latency, size_t cycle);
+
+    // Cycles a request waits on the MSHRs: a primary miss only waits if all MSHRs are busy, an access
+    // to a line that is still being fetched waits until the line arrives
+    unsigned mshr_stall(uint32_t address, bool miss, unsigned penalty, size_t cycle);
+
+    // Translates address of an access in cycle in place through the MMU if configured, sets translationCycles
+    // and translatedAddress
+    void translate(uint32_t &address, size_t cycle);
+
+    // Page-table read of the MMU through the cache in cycle, returns its latency. A miss is filled through
+    // the DRAM and bus models and the MSHRs like a demand miss, but the walk waits for the entry.
+    unsigned walk_load(uint32_t address, size_t cycle);
+
+    // Count a completed request in the latency histogram of its class
+    void record_latency(bool write, bool miss, size_t cycles);
+
+    // Wait for the fills still outstanding in the MSHRs and the stores still in the store buffer after the last request
+    void drain();
+
+    // Warm state of the cache and the written main memory pages, prefetcher and MSHRs start empty after loading
+    bool save_checkpoint(const char* path);
+    bool load_checkpoint(const char* path);
 };
 
 #endif
@@ -0,0 +1,76 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+#define CHECKPOINT_MAGIC 0x4B435343 // "CSCK"
+#define CHECKPOINT_VERSION 2
+
+// Identifies the cache a checkpoint was taken from, a checkpoint only loads into the same configuration
+struct CheckpointHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t directMapped;
+    uint32_t cacheLines;
+    uint32_t cacheLineSize;
+    uint32_t numberOfSectorOffsetBits;
+    uint32_t victimEntries;
+    uint32_t addressLength;
+    uint32_t fullyAssociative;
+};
+
+// Collects the state in memory and writes it to the file at once
+class CheckpointWriter {
+private:
+    vector<uint8_t> buffer;
+
+public:
+    template <typename T>
+    void put(const T &value) {
+        put_bytes(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+    }
+
+    void put_bytes(const uint8_t* data, size_t size);
+
+    // Returns false if the file couldn't be written
+    bool write_to_file(const char* path);
+};
+
+// Maps the checkpoint file read-only and reads it front to back
+class CheckpointReader {
+private:
+    const uint8_t* mapping;
+    size_t size;
+    size_t position;
+    bool overrun;
+
+public:
+    CheckpointReader(const char* path);
+    ~CheckpointReader();
+
+    bool is_open() const { return mapping != nullptr; }
+
+    // False once a read went past the end of the file, the values read then are zero
+    bool ok() const { return !overrun; }
+
+    template <typename T>
+    T get() {
+        T value;
+        memset(&value, 0, sizeof(T));
+        const uint8_t* data = get_bytes(sizeof(T));
+        if (data) {
+            memcpy(&value, data, sizeof(T));
+        }
+        return value;
+    }
+
+    // Returns a pointer into the mapping, or nullptr past the end of the file
+    const uint8_t* get_bytes(size_t size);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include <stddef.h>
+
+#include "io_structs.hpp"
+
+#define MAX_DAEMON_TRACES 64
+
+// Trace parsed once at startup and served by name
+typedef struct DaemonTrace {
+    const char* name;
+    Request* requests;
+    size_t numRequests;
+} DaemonTrace;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Serves JSON-lines simulation requests on the Unix domain socket at socketPath until the process is
+// terminated, at most workers simulations run at the same time. Returns EXIT_FAILURE if it can't listen.
+int run_daemon(const char* socketPath, const DaemonTrace traces[], size_t numTraces, unsigned workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
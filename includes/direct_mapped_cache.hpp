@@ -7,28 +7,48 @@
 #include "io_structs.hpp"
 #include "cache_base.hpp"
 #include "main_memory.hpp"
+#include "victim_buffer.hpp"
+#include "arena.hpp"
 
 struct CacheLine {
     uint32_t tag;
     uint8_t* data;
     bool isFirstTime = true;
+    bool isPrefetched = false;
+    uint64_t validSectors = 0;
 };
 
 class DirectMappedCache : public CacheBase {
 private:
+    Arena arena; // lines, line data and the victim buffer's data
     CacheLine* cacheLine;
     unsigned numOfCacheLines;
+    VictimBuffer* victimBuffer;
+    SimulationStatistics* statistics;
 
-    void replace(uint32_t address, CacheLine &currentEntry, uint32_t numberOfOffsetBits, CacheConfig cacheConfig);
+    unsigned replace(uint32_t address, CacheLine &currentEntry, uint32_t numberOfOffsetBits, CacheConfig cacheConfig, uint64_t sectorsToFetch);
+
+    // Returns true if the line was swapped in from the victim buffer, otherwise the evicted line is kept there
+    bool evict_to_victim_buffer(uint32_t address, CacheAddress cacheAddress, CacheLine &currentEntry, CacheConfig cacheConfig);
+
+    CacheLine& lookup(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result);
 
 public:
-    DirectMappedCache(unsigned cacheLines, CacheConfig cacheConfig);
+    DirectMappedCache(unsigned cacheLines, CacheConfig cacheConfig, unsigned victimEntries = 0,
+                      SimulationStatistics* statistics = nullptr, bool hugePages = false);
 
     ~DirectMappedCache();
 
     uint32_t read_from_cache(uint32_t address, CacheConfig cacheConfig, Result &result) override;
 
     void write_to_cache(uint32_t address, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) override;
+
+    bool prefetch(uint32_t address, CacheConfig cacheConfig) override;
+
+    uint8_t* access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) override;
+
+    void save_state(CheckpointWriter &writer, CacheConfig cacheConfig) override;
+    bool load_state(CheckpointReader &reader, CacheConfig cacheConfig) override;
 };
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef DRAM_HPP
+#define DRAM_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "io_structs.hpp"
+
+using namespace std;
+
+// Timing model of the main memory, MainMemory keeps holding the data. Addresses are mapped as
+// row | bank | channel | column, so consecutive rows are spread over the channels and banks first.
+// Requests are scheduled when the cache issues them: a row hit only waits for the column path of its
+// bank and so overtakes older row misses that still wait for precharge and activation (first-ready),
+// otherwise the bank serves them first-come-first-serve.
+class DramController {
+private:
+    struct Bank {
+        int64_t openRow = -1;        // -1 if the bank is precharged
+        size_t bankReadyCycle = 0;   // next cycle a precharge or activation may start
+        size_t columnReadyCycle = 0; // next cycle a column access to the open row may start
+    };
+
+    unsigned channels;
+    unsigned banksPerChannel;
+    uint32_t rowSize;
+    unsigned tRCD;
+    unsigned tCAS;
+    unsigned tRP;
+    bool closedPage;
+    vector<Bank> banks;
+    SimulationStatistics* statistics;
+
+public:
+    DramController(const SimulationOptions* options, SimulationStatistics* statistics);
+
+    // Returns the cycles until the data of address is available for a request arriving in cycle
+    unsigned access(uint32_t address, size_t cycle);
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include "io_structs.hpp"
 #include "cache_base.hpp"
 #include "main_memory.hpp"
+#include "arena.hpp"
 
 using namespace std;
 
@@ -19,45 +20,71 @@ private:
         uint8_t* data;
         uint32_t tagAsMapKey;
         bool isFirstTime;
+        bool isPrefetched;
+        uint64_t validSectors;
+        uint8_t owner; // stream that filled the line
         
         Node* next;
         Node* prev;
 
-        Node(uint32_t numberOfOffsetBits);
-        ~Node();
+        Node();
     };
 
     unordered_map<uint32_t, Node*> map;
+    Node* nodes; // head, tail and the ways, placed in the arena of FourWayLRUCache
+    uint32_t numberOfNodes;
     Node* head; // head = MRU
     Node* tail; // tail = LRU
+    AccessInfo* lastAccess; // owned by FourWayLRUCache
+    WayPartition* partition; // owned by FourWayLRUCache
+    RepeatLine* repeatLine; // owned by FourWayLRUCache
     
     void update_to_mru(Node* node);
     void add_node(Node* node);
     void remove_node(Node* node);
+
+    Node* lookup(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result);
         
 public:
-    LRUCache(CacheConfig cacheConfig);
-    
-    ~LRUCache();
+    LRUCache(CacheConfig cacheConfig, AccessInfo* lastAccess, WayPartition* partition, RepeatLine* repeatLine, Arena &arena);
+
+    // Arena space one set takes for its nodes and line data
+    static size_t arena_size(CacheConfig cacheConfig);
 
     uint32_t read_from_cache(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result);
 
     void write_to_cache(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result);
 
-    void replace_lru(uint32_t address, uint32_t cacheAddressTag, CacheConfig cacheConfig);
+    unsigned replace_lru(uint32_t address, uint32_t cacheAddressTag, CacheConfig cacheConfig, uint64_t sectorsToFetch);
+
+    bool prefetch(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig);
+
+    uint8_t* access_line(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result);
+
+    // Nodes are stored from MRU to LRU together with whether the map points to them, loaded lines are owned by stream 0
+    void save_state(CheckpointWriter &writer, CacheConfig cacheConfig);
+    bool load_state(CheckpointReader &reader, CacheConfig cacheConfig);
 };
 
 class FourWayLRUCache : public CacheBase {
 private:
+    Arena arena; // nodes and line data of all sets
     vector<LRUCache*> cacheSets;
 
 public:
-    FourWayLRUCache(CacheConfig cacheConfig);
+    FourWayLRUCache(CacheConfig cacheConfig, bool hugePages = false);
 
     ~FourWayLRUCache();
 
     uint32_t read_from_cache(uint32_t address, CacheConfig cacheConfig, Result &result) override;
     void write_to_cache(uint32_t address, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) override;
+
+    bool prefetch(uint32_t address, CacheConfig cacheConfig) override;
+
+    uint8_t* access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) override;
+
+    void save_state(CheckpointWriter &writer, CacheConfig cacheConfig) override;
+    bool load_state(CheckpointReader &reader, CacheConfig cacheConfig) override;
 };
 
 #endif
@@ -0,0 +1,68 @@
+#ifndef FULLYASSOCIATIVECACHE_HPP
+#define FULLYASSOCIATIVECACHE_HPP
+
+#include <cstdint>
+
+#include "address_structs.hpp"
+#include "io_structs.hpp"
+#include "cache_base.hpp"
+#include "main_memory.hpp"
+#include "arena.hpp"
+
+// One set over all lines with LRU replacement. Lines are found through an intrusive hash table on the
+// tag and kept in an intrusive LRU list, both placed in the arena at construction, so no access allocates.
+class FullyAssociativeCache : public CacheBase {
+private:
+    struct Line {
+        uint8_t* data = nullptr;
+        uint32_t tag = 0;
+        bool valid = false;
+        bool isPrefetched = false;
+        uint64_t validSectors = 0;
+
+        Line* hashNext = nullptr; // next line in the same bucket
+        Line* prev = nullptr;
+        Line* next = nullptr;
+    };
+
+    Arena arena; // lines, buckets and line data
+    Line* lines;
+    Line** buckets;
+    uint32_t numberOfBuckets;
+    unsigned bucketShift; // 32 - log2(numberOfBuckets)
+    unsigned numOfCacheLines;
+    Line* head; // head = MRU
+    Line* tail; // tail = LRU
+
+    static uint32_t number_of_buckets(unsigned cacheLines);
+
+    uint32_t bucket_of(uint32_t tag) const;
+    Line* find(uint32_t tag) const;
+    void unhash(Line* line);
+
+    void update_to_mru(Line* line);
+    void remove_line(Line* line);
+    void add_line(Line* line);
+
+    // Refill the LRU line with the line of address and return the number of sectors fetched
+    unsigned replace_lru(uint32_t address, uint32_t tag, CacheConfig cacheConfig, uint64_t sectorsToFetch);
+
+    Line* lookup(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result);
+
+public:
+    FullyAssociativeCache(unsigned cacheLines, CacheConfig cacheConfig, bool hugePages = false);
+
+    uint32_t read_from_cache(uint32_t address, CacheConfig cacheConfig, Result &result) override;
+
+    void write_to_cache(uint32_t address, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) override;
+
+    bool prefetch(uint32_t address, CacheConfig cacheConfig) override;
+
+    uint8_t* access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) override;
+
+    // Lines are stored from MRU to LRU, the hash table is rebuilt from the valid ones
+    void save_state(CheckpointWriter &writer, CacheConfig cacheConfig) override;
+    bool load_state(CheckpointReader &reader, CacheConfig cacheConfig) override;
+};
+
+#endif
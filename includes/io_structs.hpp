@@ -4,10 +4,22 @@
 #include <stdint.h>
 #include <stdio.h>
 
+// Widest access a request can describe, in Byte
+#define MAX_ACCESS_SIZE 64
+
+// Size of the main memory in Byte, addresses are CACHE_ADDRESS_LENGTH (16) bits wide
+#define MEMORY_SIZE (1u << 16)
+
+// Streams (tenants) a trace can interleave
+#define MAX_STREAMS 8
+
 typedef struct Request {
     uint32_t addr;
     uint32_t data;
     int we ;
+    unsigned size; // access width in Byte (power of two up to MAX_ACCESS_SIZE), 0 means 4
+    int fetch; // instruction fetch: a read served by the instruction cache if there is one
+    unsigned stream; // tenant issuing the request, below MAX_STREAMS
 } Request;
 
 typedef struct Result {
@@ -17,4 +29,178 @@ typedef struct Result {
     size_t primitiveGateCount;
 } Result;
 
+typedef enum PrefetcherKind {
+    PREFETCHER_NONE = 0,
+    PREFETCHER_NEXT_LINE,
+    PREFETCHER_STRIDE,
+    PREFETCHER_STREAM_BUFFER
+} PrefetcherKind;
+
+// Optional features on top of the basic simulation, all disabled when zero-initialized
+typedef struct SimulationOptions {
+    int verify;
+    PrefetcherKind prefetcher;
+    unsigned prefetchDegree;
+    unsigned mshrs;
+    unsigned issueWidth;
+    unsigned cachePorts;
+    unsigned queueDepth;
+    unsigned victimEntries;
+    unsigned victimLatency;
+    unsigned sectorSize;
+    const char* saveCheckpoint;
+    const char* loadCheckpoint;
+    unsigned sampleUnit;
+    unsigned sampleInterval;
+    unsigned sampleWarmup;
+    int dram;
+    unsigned dramChannels;
+    unsigned dramBanks;
+    unsigned dramRowSize;
+    unsigned dramTRCD;
+    unsigned dramTCAS;
+    unsigned dramTRP;
+    int dramClosedPage;
+    unsigned busWidth;
+    unsigned busBurstLength;
+    unsigned busRatio;
+    int hugePages;
+    int threadEngine;
+    int tlm;
+    unsigned tlmQuantum;
+    int fullyAssociative; // one set over all cachelines, directMapped is 0
+    int mmu;
+    unsigned l1TlbEntries;
+    unsigned l1TlbWays;
+    unsigned l2TlbEntries; // 0 if there is no L2 TLB
+    unsigned l2TlbWays;
+    unsigned l2TlbLatency;
+    unsigned pageSize;
+    unsigned walkCacheEntries;
+    unsigned icacheLines; // 0 if fetches share the data cache
+    unsigned icacheLineSize;
+    unsigned icacheLatency;
+    int icacheDirectMapped;
+    int icacheFullyAssociative;
+    uint32_t wayMasks[MAX_STREAMS]; // ways each stream may fill in the 4-way cache, 0 for all
+    unsigned storeBufferEntries; // 0 if stores write through to the main memory directly
+} SimulationOptions;
+
+// Log-bucketed (HDR-style) latency histogram: latencies below 2^LATENCY_SUB_BUCKET_BITS cycles are
+// counted exactly, above that every power of two is split into 2^LATENCY_SUB_BUCKET_BITS buckets, so a
+// reported percentile is at most 1/16 above the recorded latency
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS)
+
+typedef struct LatencyHistogram {
+    size_t counts[LATENCY_BUCKETS];
+    size_t requests;
+    size_t totalCycles;
+    size_t maxCycles;
+} LatencyHistogram;
+
+typedef enum LatencyClass {
+    LATENCY_READ_HIT = 0,
+    LATENCY_READ_MISS,
+    LATENCY_WRITE_HIT,
+    LATENCY_WRITE_MISS,
+    LATENCY_CLASSES
+} LatencyClass;
+
+// Additional measurements that don't fit into Result without breaking its layout
+typedef struct SimulationStatistics {
+    // Requests the run got to before the end of the trace or the cycle limit
+    size_t processedRequests;
+
+    // Lockstep golden-model verification (--verify)
+    size_t verifiedReads;
+    size_t divergences;
+    size_t firstDivergenceIndex;
+    uint32_t firstDivergenceAddress;
+    uint32_t expectedData;
+    uint32_t actualData;
+
+    // Prefetcher (--prefetcher)
+    size_t prefetchesIssued;
+    size_t usefulPrefetches;
+    size_t latePrefetches;
+    size_t uncoveredMisses;
+
+    // Non-blocking cache (--mshrs)
+    size_t mshrAllocations;
+    size_t mshrMerges;
+    size_t mshrStallCycles;
+    size_t mshrOccupancyCycles;
+    size_t mshrPeakOccupancy;
+
+    // Request queue (--issue-width)
+    size_t queueFullStalls;
+    size_t outOfOrderCompletions;
+    size_t totalRequestLatency;
+    size_t maxRequestLatency;
+
+    // Victim buffer of the direct-mapped cache (--victim-entries)
+    size_t victimHits;
+
+    // Sectored lines (--sector-size), sectorsFetched counts the fill traffic
+    size_t sectorMisses;
+    size_t sectorsFetched;
+
+    // Accesses that span more than one cacheline
+    size_t splitAccesses;
+
+    // Sampled mode (--sample-interval), Result.cycles is extrapolated from the measured units
+    size_t sampledUnits;
+    size_t detailedRequests;
+    size_t detailedCycles;
+    double cyclesConfidenceInterval; // half-width of the 95% confidence interval in cycles
+
+    // DRAM timing model (--dram-timing), row empty means the bank was precharged
+    size_t dramRowHits;
+    size_t dramRowEmpty;
+    size_t dramRowConflicts;
+    size_t dramQueueCycles;
+
+    // Memory bus (--bus-width), busBytes includes the write-through data
+    size_t busTransfers;
+    size_t busBytes;
+    size_t busBusyCycles;
+    size_t busQueueCycles;
+
+    // Address translation (--tlb), walk loads are the page-table reads that went through the cache
+    size_t l1TlbHits;
+    size_t l1TlbMisses;
+    size_t l2TlbHits;
+    size_t l2TlbMisses;
+    size_t walkCacheHits;
+    size_t walkLoads;
+    size_t walkLoadMisses;
+    size_t walkLoadVictimHits; // kept out of victimHits, which counts demand accesses
+    size_t walkCycles;
+
+    // Split instruction cache (--icache), Result counts the fetches together with the data accesses
+    size_t instructionHits;
+    size_t instructionMisses;
+
+    // Per stream, occupancy sums the 4-way cache lines a stream owns over all accesses
+    size_t streamHits[MAX_STREAMS];
+    size_t streamMisses[MAX_STREAMS];
+    size_t streamOccupancy[MAX_STREAMS];
+    size_t occupancySamples;
+
+    // Store buffer (--store-buffer), a combined store only wrote into entries that were already open
+    size_t storeBufferStores;
+    size_t storeBufferCombines;
+    size_t storeBufferDrains;
+    size_t storeBufferDrainedBytes;
+    size_t storeBufferFullStalls; // stores that found the buffer full, once per store
+    size_t storeBufferStallCycles;
+    size_t storeBufferForwards;
+    size_t storeBufferOccupancyCycles;
+    size_t storeBufferPeakOccupancy;
+
+    // Cycles from the start (queued mode: the issue) to the completion of every timed request
+    LatencyHistogram latency[LATENCY_CLASSES];
+} SimulationStatistics;
+
 #endif
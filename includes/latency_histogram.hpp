@@ -0,0 +1,27 @@
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <stddef.h>
+
+#include "io_structs.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Count one request, only touches the fixed buckets of the histogram
+void latency_record(LatencyHistogram* histogram, size_t cycles);
+
+// Adds the requests of from to into, e.g. to report all reads together
+void latency_merge(LatencyHistogram* into, const LatencyHistogram* from);
+
+// Latency at or below which percentile percent of the requests completed, the upper end of its bucket
+size_t latency_percentile(const LatencyHistogram* histogram, double percentile);
+
+double latency_mean(const LatencyHistogram* histogram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,11 +2,18 @@
 #define MAINMEMORY_HPP
 
 #include <cstdint>
+#include <vector>
+
+#include "checkpoint.hpp"
+
+// Granularity in which written memory is tracked for checkpoints
+#define MEMORY_PAGE_SIZE 256
 
 class MainMemory {
 private:
     uint8_t* data;
     uint32_t memorySize;
+    std::vector<bool> touchedPages;
 
 public: 
     MainMemory(unsigned cacheAddressLength);
@@ -15,6 +22,19 @@ public:
     uint8_t read_from_ram(uint32_t address);
     
     void write_to_ram(uint32_t address, uint8_t data_to_write);
+
+    void write_span(uint32_t address, const uint8_t* dataToWrite, uint32_t size);
+
+    // Line fills read whole sectors at once, bytes beyond the memory read as read_from_ram does
+    void read_span(uint32_t address, uint8_t* dataToRead, uint32_t size);
+
+    // Backing storage for read-only direct memory access, writes have to go through write_span
+    const uint8_t* direct_pointer() const { return data; }
+    uint32_t size() const { return memorySize; }
+
+    // Only pages that have been written are part of a checkpoint
+    void save_pages(CheckpointWriter &writer);
+    bool load_pages(CheckpointReader &reader);
 };
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef MEMORYBUS_HPP
+#define MEMORYBUS_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "io_structs.hpp"
+
+// Shared bus between the cache and the main memory. A transfer is padded to whole bursts of
+// burstLength beats of width Byte, every beat takes ratio cache cycles. Transfers are served in
+// the order they are requested, so fills queue behind each other and behind write-through data.
+class MemoryBus {
+private:
+    uint32_t width;
+    unsigned burstLength;
+    unsigned ratio;
+    size_t busFreeCycle;
+    SimulationStatistics* statistics;
+
+    unsigned transfer_cycles(uint32_t bytes) const;
+
+    // Reserve the bus for bytes once it is free, returns the cycle the transfer ends
+    size_t transfer(size_t readyCycle, uint32_t bytes);
+
+public:
+    MemoryBus(const SimulationOptions* options, SimulationStatistics* statistics);
+
+    // Data that is available at the memory side in readyCycle arrives in the returned cycle
+    size_t read(size_t readyCycle, uint32_t bytes);
+
+    // Write-through data occupies the bus but doesn't stall the write itself
+    void write(size_t cycle, uint32_t bytes);
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MMU_HPP
+#define MMU_HPP
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "io_structs.hpp"
+
+using namespace std;
+
+#define PAGE_TABLE_LEVELS 4
+#define PAGE_TABLE_INDEX_BITS 9
+#define PAGE_TABLE_ENTRY_SIZE 8
+#define PAGE_TABLE_SIZE 4096
+
+// Set-associative TLB with LRU replacement, entries are tagged with the virtual page number
+class Tlb {
+private:
+    struct Entry {
+        bool valid = false;
+        uint32_t virtualPage = 0;
+        uint64_t lastUse = 0;
+    };
+
+    unsigned sets;
+    unsigned ways;
+    vector<Entry> entries;
+    uint64_t useCounter;
+
+public:
+    Tlb(unsigned entries, unsigned ways);
+
+    // Returns true on a hit and makes the entry the most recently used of its set
+    bool lookup(uint32_t virtualPage);
+    void insert(uint32_t virtualPage);
+};
+
+// Translation stage in front of the cache, modelled on x86-64: an L1 and an optional L2 TLB, and on a
+// miss of both a radix walk over 4 levels of 512 entries, one level less for 2 MiB pages. The page
+// tables occupy the top frames of the main memory and every level is read through the data cache, so
+// walks compete with the demand accesses for lines. The walk cache keeps non-leaf entries, a hit skips
+// the upper levels. Virtual pages are mapped to the frames with the same number, the 16-bit address
+// space has no room for separate frames, so only the timing of the translation is modelled.
+class MMU {
+private:
+    Tlb l1Tlb;
+    Tlb* l2Tlb;
+    unsigned l2TlbLatency;
+    unsigned pageOffsetBits;
+    unsigned leafLevel; // 1 for 4 KiB pages, 2 for 2 MiB pages
+    uint32_t pageTableBase;
+    unsigned walkCacheEntries;
+    vector<pair<uint64_t, uint64_t>> walkCache; // (level << 32 | virtual address prefix, last use)
+    uint64_t walkCacheUse;
+    SimulationStatistics* statistics;
+
+    // Reads the page-table entry at address through the cache in cycle, returns the cycles the read takes
+    function<unsigned(uint32_t address, size_t cycle)> walkLoad;
+
+    // Number of virtual address bits below the part that indexes level
+    static unsigned level_shift(unsigned level);
+
+    bool walk_cache_lookup(unsigned level, uint32_t virtualAddress);
+    void walk_cache_insert(unsigned level, uint32_t virtualAddress);
+
+    unsigned walk(uint32_t virtualAddress, size_t cycle);
+
+public:
+    MMU(const SimulationOptions* options, uint32_t memorySize, SimulationStatistics* statistics,
+        function<unsigned(uint32_t, size_t)> walkLoad);
+    ~MMU();
+
+    // Translates virtualAddress for an access in cycle and returns the cycles the translation adds to it.
+    // An L1 TLB hit is free, as a VIPT cache looks it up in parallel with its sets.
+    unsigned translate(uint32_t virtualAddress, uint32_t &physicalAddress, size_t cycle);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MSHR_HPP
+#define MSHR_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "io_structs.hpp"
+
+using namespace std;
+
+// Miss status holding registers of a non-blocking cache. Every entry tracks one outstanding line fill,
+// further misses to the same line merge into it instead of issuing another memory access.
+class MissStatusHoldingRegisters {
+private:
+    struct Entry {
+        uint32_t lineAddress;
+        size_t readyCycle;
+    };
+
+    vector<Entry> entries;
+    unsigned numberOfEntries;
+    SimulationStatistics* statistics;
+
+public:
+    MissStatusHoldingRegisters(unsigned numberOfEntries, SimulationStatistics* statistics);
+
+    // Free all entries whose line has arrived and account the occupancy of the current cycle
+    void tick(size_t cycle);
+
+    // Returns true if the line is still being fetched, the access is merged into its entry
+    // and readyCycle (if given) is set to the arrival of the line
+    bool merge(uint32_t lineAddress, size_t cycle, size_t* readyCycle = nullptr);
+
+    // Allocate an entry for a primary miss that needs penalty cycles, returns the cycles
+    // the cache stalls because all entries are occupied. A secondary miss merges into the
+    // entry of its line and returns the cycles until the line arrives.
+    unsigned allocate(uint32_t lineAddress, size_t cycle, unsigned penalty);
+
+    // Cycles until the last outstanding fill has arrived, the occupancy of these cycles is accounted
+    size_t drain(size_t cycle);
+
+    size_t occupancy() const;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef PREFETCHER_HPP
+#define PREFETCHER_HPP
+
+#include <unordered_map>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "address_structs.hpp"
+#include "io_structs.hpp"
+#include "cache_base.hpp"
+
+using namespace std;
+
+// Hardware prefetcher observing the demand stream of CACHE_MODULE. It decides the memory penalty of
+// every demand access: misses pay memoryLatency unless a prefetch already covers the line, hits on a
+// prefetched line that is still in flight pay the remaining latency.
+class Prefetcher {
+protected:
+    CacheBase* cache;
+    CacheConfig cacheConfig;
+    unsigned memoryLatency;
+    uint32_t memorySize;
+    uint32_t lineSize;
+    unsigned degree;
+    SimulationStatistics* statistics;
+
+    // Latency of fetching bytes at address from the main memory, set if it isn't the constant memoryLatency
+    function<unsigned(uint32_t address, uint32_t bytes, unsigned latency, size_t cycle)> memoryFill;
+
+    // Line address -> cycle in which the prefetched line arrives from the main memory
+    unordered_map<uint32_t, size_t> inFlight;
+
+    uint32_t line_address(uint32_t address) const;
+
+    // Cycles until a prefetched line arrives
+    unsigned fill_latency(uint32_t lineAddress, size_t cycle);
+
+    // Fill a line into the cache, ignored if it is outside the main memory or already cached
+    void issue(uint32_t lineAddress, size_t cycle);
+
+    // Update the predictor state with a demand access and issue new prefetches
+    virtual void train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) = 0;
+
+    // Side-buffer prefetchers may serve a demand miss, readyCycle is the arrival of the line
+    virtual bool serve_miss(uint32_t lineAddress, size_t cycle, size_t &readyCycle);
+
+public:
+    Prefetcher(CacheBase* cache, CacheConfig cacheConfig, unsigned memoryLatency, uint32_t memorySize,
+               unsigned degree, SimulationStatistics* statistics);
+    virtual ~Prefetcher() = default;
+
+    // Prefetches compete with the demand misses for the DRAM banks and the memory bus
+    void set_memory_fill(function<unsigned(uint32_t, uint32_t, unsigned, size_t)> memoryFill) { this->memoryFill = memoryFill; }
+
+    // True if the prefetcher would serve a demand miss on the line without going to the main memory
+    virtual bool holds_line(uint32_t lineAddress) const;
+
+    // Returns the number of cycles the demand access has to wait for the main memory,
+    // missLatency is what a miss that no prefetch covers costs
+    unsigned access(uint32_t address, bool miss, bool prefetchedHit, size_t cycle, unsigned missLatency);
+
+    static Prefetcher* create(PrefetcherKind kind, CacheBase* cache, CacheConfig cacheConfig, unsigned memoryLatency,
+                              uint32_t memorySize, unsigned degree, SimulationStatistics* statistics);
+};
+
+// Tagged next-line prefetcher: a miss or the first hit on a prefetched line fetches the following lines
+class NextLinePrefetcher : public Prefetcher {
+protected:
+    void train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) override;
+
+public:
+    using Prefetcher::Prefetcher;
+};
+
+// Reference prediction table without program counters. Entries are matched by address proximity,
+// a stride seen twice in a row switches the entry to steady state, which prefetches ahead.
+class StridePrefetcher : public Prefetcher {
+private:
+    enum State { INITIAL, TRANSIENT, STEADY };
+
+    struct Entry {
+        uint32_t lastAddress;
+        int32_t stride;
+        State state;
+        size_t lastUse;
+    };
+
+    static const unsigned TABLE_ENTRIES = 8;
+    static const uint32_t MAX_DISTANCE = 256;
+
+    vector<Entry> table;
+
+protected:
+    void train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) override;
+
+public:
+    using Prefetcher::Prefetcher;
+};
+
+// Jouppi stream buffers: a miss that isn't at the head of any buffer allocates the least recently used
+// buffer with the following lines. The lines stay in the buffer until a demand miss consumes the head.
+class StreamBufferPrefetcher : public Prefetcher {
+private:
+    struct StreamBuffer {
+        vector<uint32_t> lineAddresses;
+        vector<size_t> readyCycles;
+        size_t head = 0;
+        size_t lastUse = 0;
+        bool valid = false;
+    };
+
+    static const unsigned STREAM_BUFFERS = 4;
+
+    vector<StreamBuffer> buffers;
+    bool lastMissServed = false;
+
+    void refill(StreamBuffer &buffer, size_t slot, uint32_t lineAddress, size_t cycle);
+
+protected:
+    void train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) override;
+    bool serve_miss(uint32_t lineAddress, size_t cycle, size_t &readyCycle) override;
+
+public:
+    using Prefetcher::Prefetcher;
+
+    bool holds_line(uint32_t lineAddress) const override;
+};
+
+#endif
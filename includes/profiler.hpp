@@ -0,0 +1,33 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <stddef.h>
+
+// Phases of a run measured by --profile, a phase may be entered several times and accumulates
+typedef enum ProfilePhase {
+    PROFILE_INPUT,       // read_csv and parse_data
+    PROFILE_ELABORATION, // construction and binding of the SystemC modules, checkpoint loading
+    PROFILE_SIMULATION,  // sc_start calls until the last request has completed
+    PROFILE_OUTPUT,      // closing the VCD file and writing the checkpoint
+    PROFILE_PHASES
+} ProfilePhase;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opens the host counters, all other calls do nothing until the profiler is enabled
+void profiler_enable(void);
+
+void profiler_begin(ProfilePhase phase);
+void profiler_end(ProfilePhase phase);
+
+// Prints wall and CPU time, peak RSS and the host counters per phase and closes the counters.
+// simulatedRequests are the requests the run processed, which is less than the trace at the cycle limit.
+void profiler_report(size_t simulatedRequests);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef REFERENCEMEMORY_HPP
+#define REFERENCEMEMORY_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "io_structs.hpp"
+#include "main_memory.hpp"
+
+// Flat golden model of the main memory. Every write is mirrored here and every value
+// returned by read_from_cache is compared against it, independent of the input trace.
+class ReferenceMemory {
+private:
+    uint8_t* data;
+    uint32_t memorySize;
+
+public:
+    ReferenceMemory(unsigned cacheAddressLength);
+    ~ReferenceMemory();
+
+    // Start from the contents of the main memory, e.g. after loading a checkpoint
+    void copy_from(MainMemory &memory);
+
+    // Writes size bytes (0 means 4), repeating the 32-bit data like the cache does for wide writes
+    void write(uint32_t address, uint32_t dataToWrite, unsigned size);
+
+    // Returns false and records the divergence in statistics if actualData differs from the model,
+    // only the first min(size, 4) bytes of a read are returned and compared
+    bool check(size_t requestIndex, uint32_t address, unsigned size, uint32_t actualData, SimulationStatistics &statistics);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef STOREBUFFER_HPP
+#define STOREBUFFER_HPP
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include "io_structs.hpp"
+
+using namespace std;
+
+// Write-combining store buffer between the cache and the main memory. A store retires once its bytes are
+// merged into the open entry of their line, the entries are written to the main memory one after the other
+// in the background. The oldest entry starts draining once a younger entry exists or all its bytes are
+// written, so consecutive stores to a line combine into one memory write. Only the timing is modelled:
+// the cache still writes the main memory immediately, which is what forwarding makes the loads see.
+// Store misses still write-allocate, the cache tracks that fill so later loads of the line wait for it.
+class StoreBuffer {
+private:
+    struct Entry {
+        uint32_t lineAddress;
+        vector<bool> written;
+        uint32_t writtenBytes;
+        size_t readyCycle; // from here on the entry may drain, SIZE_MAX while it is the open tail
+        size_t drainedCycle; // its memory write completes, SIZE_MAX until the write started
+    };
+
+    deque<Entry> entries;
+    unsigned numberOfEntries;
+    uint32_t lineSize;
+    size_t memoryFreeCycle;
+    size_t accountedCycle;
+    SimulationStatistics* statistics;
+    function<unsigned(uint32_t, uint32_t, size_t)> drainLatency;
+
+    // Start the memory write of the oldest entry in cycle, the previous write has completed by then
+    void start_drain(size_t cycle);
+
+    // Remove the oldest entry, its memory write has completed
+    void retire_oldest();
+
+    // Occupancy up to cycle
+    void account(size_t cycle);
+
+public:
+    // drainLatency returns the cycles the memory write of bytes of the line at address takes if it starts in cycle
+    StoreBuffer(unsigned numberOfEntries, uint32_t lineSize, SimulationStatistics* statistics,
+                function<unsigned(uint32_t address, uint32_t bytes, size_t cycle)> drainLatency);
+
+    // Retire all entries whose memory write completed up to cycle and start the next one if it may drain.
+    // Called every cycle by the cycle-accurate engines, so the entries drain in the background.
+    void tick(size_t cycle);
+
+    // Buffer a store of size bytes at address in cycle, returns the cycles it stalls because the buffer is full
+    unsigned store(uint32_t address, unsigned size, size_t cycle);
+
+    // True if every byte of the load is still buffered in cycle, the load is then served from the buffer
+    bool forwards(uint32_t address, unsigned size, size_t cycle);
+
+    // Cycles until the last entry has been written to the main memory, the open tail doesn't wait for more stores
+    size_t drain(size_t cycle);
+
+    size_t occupancy() const;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TLMINITIATOR_HPP
+#define TLMINITIATOR_HPP
+
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#include <vector>
+#include <cstdint>
+
+#include "io_structs.hpp"
+#include "tlm_memory.hpp"
+
+using namespace std;
+using namespace sc_core;
+
+// Stream (tenant) of a transaction, transactions without it belong to stream 0
+struct StreamExtension : tlm::tlm_extension<StreamExtension> {
+    unsigned stream = 0;
+
+    tlm::tlm_extension_base* clone() const override;
+    void copy_from(const tlm::tlm_extension_base &extension) override;
+};
+
+// Core model of the loosely-timed mode: replays the requests through a blocking b_transport each and
+// runs ahead of the SystemC time by up to one quantum (temporal decoupling) before it synchronizes.
+SC_MODULE(TLM_INITIATOR) {
+    tlm_utils::simple_initiator_socket<TLM_INITIATOR> socket;
+    tlm_utils::simple_initiator_socket<TLM_INITIATOR> fetchSocket; // instruction fetches
+    tlm_utils::tlm_quantumkeeper quantumKeeper;
+    StreamExtension streamExtension;
+
+    Request* requests;
+    size_t numRequests;
+    int cycles;
+
+    // First 4 bytes read by every request in order, for --verify
+    vector<uint32_t> readData;
+    size_t processedRequests;
+
+    SC_CTOR(TLM_INITIATOR);
+    TLM_INITIATOR(sc_module_name name, Request* requests, size_t numRequests, int cycles, unsigned quantum, bool enabled);
+
+    void run();
+};
+
+#endif
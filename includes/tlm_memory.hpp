@@ -0,0 +1,31 @@
+#ifndef TLMMEMORY_HPP
+#define TLMMEMORY_HPP
+
+#include <systemc>
+#include <tlm>
+#include <tlm_utils/simple_target_socket.h>
+#include <cstdint>
+
+#include "main_memory_global.hpp"
+
+using namespace std;
+using namespace sc_core;
+
+// Period of the clock of run_simulation, delays of the loosely-timed interface are multiples of it
+#define CYCLE_TIME sc_time(1, SC_SEC)
+
+// Loosely-timed TLM-2.0 target in front of the global main memory. Every transaction is annotated with
+// memoryLatency cycles. Initiators get a read-only DMI pointer with the same latency, writes keep going
+// through b_transport so that the written pages are tracked for checkpoints. The cache only takes the
+// latency from this target, its fills and write-throughs still use the MainMemory calls directly.
+SC_MODULE(TLM_MEMORY) {
+    tlm_utils::simple_target_socket<TLM_MEMORY> socket;
+    unsigned memoryLatency;
+
+    TLM_MEMORY(sc_module_name name, unsigned memoryLatency);
+
+    void b_transport(tlm::tlm_generic_payload &transaction, sc_time &delay);
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload &transaction, tlm::tlm_dmi &dmi);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef TRACEIMPORT_HPP
+#define TRACEIMPORT_HPP
+
+#include <stddef.h>
+
+#include "io_structs.hpp"
+
+enum TraceFormat {
+    TRACE_CSV,    // Our own 'R/W, <addr>, <data>[, <size>]' lines, read by parse_data
+    TRACE_DIN,    // Dinero '<label> <hex addr> [<hex size>]' lines
+    TRACE_LACKEY, // valgrind --tool=lackey --trace-mem=yes output
+    TRACE_BINARY  // ChampSim input_instr records of 64 Byte
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maps the trace at path and converts its data accesses, and its instruction fetches if fetches is set,
+// into requests, without allocating or copying the file. Only counts the requests if requests is NULL,
+// otherwise fills in at most capacity of them. Returns the number of requests or -1 if the trace can't be read.
+long import_trace(const char* path, enum TraceFormat format, Request requests[], size_t capacity, int fetches);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef VICTIMBUFFER_HPP
+#define VICTIMBUFFER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "checkpoint.hpp"
+#include "arena.hpp"
+
+using namespace std;
+
+// Small fully-associative buffer holding lines recently evicted from a direct-mapped cache.
+// Lines are identified by their line number (address without offset bits) and replaced LRU.
+// Line data is exchanged by swapping buffers, so a swap with the cache never copies bytes. The buffers
+// come from the arena of the cache, since they end up in the cache lines and the other way around.
+class VictimBuffer {
+private:
+    struct Entry {
+        uint32_t lineNumber;
+        uint8_t* data;
+        uint64_t validSectors;
+        bool valid;
+        size_t lastUse;
+    };
+
+    vector<Entry> entries;
+    size_t useCounter;
+    uint32_t lineSize;
+
+public:
+    VictimBuffer(unsigned numberOfEntries, uint32_t lineSize, Arena &arena);
+
+    // Swap the buffered line with the line evicted from the cache, returns false if lineNumber isn't buffered
+    bool swap(uint32_t lineNumber, uint8_t* &lineData, uint64_t &validSectors, bool evictedValid, uint32_t evictedLineNumber);
+
+    // Keep an evicted line by replacing the least recently used entry, lineData receives the freed buffer
+    void insert(uint32_t lineNumber, uint8_t* &lineData, uint64_t validSectors);
+
+    void save_state(CheckpointWriter &writer);
+    bool load_state(CheckpointReader &reader);
+};
+
+#endif
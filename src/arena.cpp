@@ -0,0 +1,73 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <sys/mman.h>
+
+#include "../includes/arena.hpp"
+
+using namespace std;
+
+// Size of the explicit huge pages from /proc/meminfo, 2 MiB if it isn't available
+static size_t huge_page_size() {
+    ifstream meminfo("/proc/meminfo");
+    string key;
+    size_t kiloBytes;
+    while (meminfo >> key) {
+        if (key == "Hugepagesize:" && meminfo >> kiloBytes) {
+            return kiloBytes * 1024;
+        }
+        getline(meminfo, key);
+    }
+    return 2 * 1024 * 1024;
+}
+
+Arena::Arena(size_t capacity, bool hugePages) : base(nullptr), capacity(capacity), used(0), mapped(false), mappedLength(0) {
+    if (hugePages) {
+        // Explicit huge pages if the system has them reserved, otherwise transparent huge pages. A huge page
+        // mapping has to be mapped and unmapped in whole huge pages.
+        size_t hugePageSize = huge_page_size();
+        mappedLength = (capacity + hugePageSize - 1) / hugePageSize * hugePageSize;
+        void* address = mmap(nullptr, mappedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (address == MAP_FAILED) {
+            mappedLength = capacity;
+            address = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, capacity, MADV_HUGEPAGE);
+            }
+        }
+        if (address != MAP_FAILED) {
+            base = static_cast<uint8_t*>(address);
+            mapped = true;
+        }
+    }
+
+    if (!base) {
+        size_t rounded = (capacity + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+        base = static_cast<uint8_t*>(aligned_alloc(ARENA_ALIGNMENT, rounded));
+        if (!base) {
+            cerr << "Error: Can't allocate " << capacity << " Byte for the cache storage" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+Arena::~Arena() {
+    if (mapped) {
+        if (munmap(base, mappedLength) != 0) {
+            cerr << "Error: Can't unmap " << mappedLength << " Byte of cache storage" << endl;
+        }
+    } else {
+        free(base);
+    }
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    size_t start = (used + alignment - 1) / alignment * alignment;
+    if (start + size > capacity) {
+        cerr << "Error: Cache storage arena of " << capacity << " Byte is exhausted" << endl;
+        exit(EXIT_FAILURE);
+    }
+    used = start + size;
+    return base + start;
+}
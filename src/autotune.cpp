@@ -0,0 +1,420 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../includes/autotune.hpp"
+#include "../includes/cache_module.hpp"
+#include "../includes/latency_histogram.hpp"
+
+using namespace std;
+
+#define AUTOTUNE_MIN_LINE_SIZE 4
+#define AUTOTUNE_MAX_LINE_SIZE 128
+
+// One point of the search space, estimated functionally and possibly confirmed in detail
+struct Candidate {
+    int directMapped;
+    bool fullyAssociative;
+    unsigned cacheLines;
+    unsigned cacheLineSize;
+    uint32_t gates;
+    double estimate; // cycles or AMAT of the functional run
+    bool confirmed;
+    Result result;
+    double amat;
+};
+
+// Record a worker writes into its pipe per candidate
+struct FunctionalRecord {
+    size_t index;
+    double estimate;
+};
+
+struct DetailedRecord {
+    Result result;
+    double amat;
+};
+
+static const char* organization_name(const Candidate &candidate) {
+    if (candidate.fullyAssociative) {
+        return "fully-associative";
+    }
+    return candidate.directMapped ? "directmapped" : "fourway";
+}
+
+// Same constraints main applies to a hand-picked configuration
+static bool candidate_allowed(const Candidate &candidate, const SimulationOptions* options) {
+    bool fourway = !candidate.directMapped && !candidate.fullyAssociative;
+    bool partitioned = false;
+    for (unsigned stream = 0; stream < MAX_STREAMS; stream++) {
+        partitioned = partitioned || options->wayMasks[stream] != 0;
+    }
+    if ((options->victimEntries > 0 && !candidate.directMapped) || (partitioned && !fourway)) {
+        return false;
+    }
+    if (options->sectorSize > 0 && (options->sectorSize > candidate.cacheLineSize ||
+                                    candidate.cacheLineSize / options->sectorSize > 64)) {
+        return false;
+    }
+
+    // VIPT: the set index has to come from the page offset
+    unsigned sets = candidate.directMapped ? candidate.cacheLines : (fourway ? candidate.cacheLines / 4 : 1);
+    if (options->mmu && static_cast<uint64_t>(sets) * candidate.cacheLineSize > options->pageSize) {
+        return false;
+    }
+
+    // Every set needs tag bits, the 4-way sets hold one node per tag bit and the way masks select among them
+    CacheConfig cacheConfig = cache_config(candidate.cacheLines, candidate.cacheLineSize, candidate.directMapped,
+                                           candidate.fullyAssociative, options->sectorSize);
+    if (cacheConfig.numberOfTagBits < 1) {
+        return false;
+    }
+    for (unsigned stream = 0; partitioned && stream < MAX_STREAMS; stream++) {
+        if (cacheConfig.numberOfTagBits < 32 && (options->wayMasks[stream] >> cacheConfig.numberOfTagBits) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Power-of-two cachelines and cacheline sizes of every organization up to the address space, within the budget
+static vector<Candidate> enumerate_candidates(const SimulationOptions* options, size_t gateBudget) {
+    vector<Candidate> candidates;
+    for (int organization = 0; organization < 3; organization++) {
+        for (unsigned lineSize = AUTOTUNE_MIN_LINE_SIZE; lineSize <= AUTOTUNE_MAX_LINE_SIZE; lineSize <<= 1) {
+            for (unsigned lines = (organization == 1) ? 4 : 1;
+                 static_cast<uint64_t>(lines) * lineSize <= (1u << CACHE_ADDRESS_LENGTH); lines <<= 1) {
+                // The data storage alone, 8 bits of 4 gates per Byte, grows with the cachelines
+                if (static_cast<uint64_t>(lines) * lineSize * 8 * 4 > gateBudget) {
+                    break;
+                }
+
+                Candidate candidate = {};
+                candidate.directMapped = organization == 0;
+                candidate.fullyAssociative = organization == 2;
+                candidate.cacheLines = lines;
+                candidate.cacheLineSize = lineSize;
+                if (!candidate_allowed(candidate, options)) {
+                    continue;
+                }
+
+                // The remaining gates needn't grow monotonically with the options, every candidate is checked
+                candidate.gates = primitive_gate_count(candidate.directMapped, candidate.fullyAssociative, lines, lineSize, options);
+                if (candidate.gates > gateBudget) {
+                    continue;
+                }
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    return candidates;
+}
+
+// Blocking model without SystemC: the tag latency, the access cycle and the fill of every miss. Fetches are
+// left out if a fixed instruction cache serves them, prefetcher, DRAM and bus timing only show in detail.
+static double functional_estimate(const Candidate &candidate, unsigned cacheLatency, unsigned memoryLatency,
+                                  size_t numRequests, const Request requests[], const SimulationOptions* options,
+                                  AutotuneObjective objective) {
+    CacheConfig cacheConfig = cache_config(candidate.cacheLines, candidate.cacheLineSize, candidate.directMapped,
+                                           candidate.fullyAssociative, options->sectorSize);
+    unsigned sectorsPerLine = 1u << (cacheConfig.numberOfOffsetBits - cacheConfig.numberOfSectorOffsetBits);
+    unsigned victimLatency = options->victimLatency > 0 ? options->victimLatency : cacheLatency;
+    SimulationStatistics* statistics = new SimulationStatistics();
+    CacheBase* cache = create_cache(candidate.cacheLines, cacheConfig, candidate.directMapped, candidate.fullyAssociative,
+                                    options->victimEntries, statistics, false);
+    for (unsigned stream = 0; stream < MAX_STREAMS; stream++) {
+        cache->partition.wayMasks[stream] = options->wayMasks[stream];
+    }
+
+    Result result = {};
+    uint8_t span[MAX_ACCESS_SIZE] = {};
+    size_t accesses = 0;
+    size_t totalCycles = 0;
+    for (size_t i = 0; i < numRequests; i++) {
+        const Request &request = requests[i];
+        if (request.fetch && options->icacheLines > 0) {
+            continue;
+        }
+        unsigned size = request.size ? request.size : 4;
+
+        // A run of accesses inside the line of the previous one only hits and leaves the cache as it is, it is
+        // counted at once. Its writes are skipped, the estimate writes no data but zeros.
+        size_t run = 0;
+        size_t next = i;
+        for (; next < numRequests; next++) {
+            const Request &repeated = requests[next];
+            if (repeated.fetch && options->icacheLines > 0) {
+                continue;
+            }
+            if (!cache->repeats_line(repeated.addr, repeated.size ? repeated.size : 4, cacheConfig)) {
+                break;
+            }
+            run++;
+        }
+        if (run > 0) {
+            cache->repeat_hits(run, result);
+            totalCycles += run * (cacheLatency + 1);
+            accesses += run;
+            i = next - 1;
+            continue;
+        }
+
+        size_t currentMisses = result.misses;
+        cache->partition.stream = request.stream;
+        if (request.we) {
+            cache->write_span(request.addr, size, span, cacheConfig, result);
+        } else {
+            cache->read_span(request.addr, size, span, cacheConfig, result);
+        }
+
+        unsigned penalty = 0;
+        if (result.misses > currentMisses) {
+            penalty = (memoryLatency * cache->lastAccess.sectorsFetched + sectorsPerLine - 1) / sectorsPerLine;
+        }
+        if (cache->lastAccess.victimHit) {
+            penalty = max(penalty, victimLatency);
+        }
+        totalCycles += cacheLatency + penalty + 1;
+        accesses++;
+    }
+    delete cache;
+    delete statistics;
+
+    if (objective == AUTOTUNE_AMAT) {
+        return accesses ? static_cast<double>(totalCycles) / accesses : 0.0;
+    }
+    return static_cast<double>(totalCycles);
+}
+
+// Estimates the candidates in workers forked processes, worker w takes every workers-th candidate
+static bool estimate_candidates(vector<Candidate> &candidates, unsigned cacheLatency, unsigned memoryLatency,
+                                size_t numRequests, const Request requests[], const SimulationOptions* options,
+                                AutotuneObjective objective, unsigned workers) {
+    vector<int> resultFds;
+    vector<pid_t> pids;
+    for (unsigned worker = 0; worker < workers; worker++) {
+        int resultPipe[2];
+        if (pipe(resultPipe) != 0) {
+            break;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(resultPipe[0]);
+            close(resultPipe[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(resultPipe[0]);
+            bool written = true;
+            for (size_t index = worker; index < candidates.size(); index += workers) {
+                FunctionalRecord record = {index, functional_estimate(candidates[index], cacheLatency, memoryLatency,
+                                                                      numRequests, requests, options, objective)};
+                written = written && write(resultPipe[1], &record, sizeof(record)) == sizeof(record);
+            }
+            _exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        close(resultPipe[1]);
+        resultFds.push_back(resultPipe[0]);
+        pids.push_back(pid);
+    }
+
+    // A worker blocks once its pipe is full, until its records are read here
+    size_t estimated = 0;
+    for (size_t worker = 0; worker < resultFds.size(); worker++) {
+        FunctionalRecord record;
+        while (read(resultFds[worker], &record, sizeof(record)) == sizeof(record)) {
+            if (record.index < candidates.size()) {
+                candidates[record.index].estimate = record.estimate;
+                estimated++;
+            }
+        }
+        close(resultFds[worker]);
+        waitpid(pids[worker], NULL, 0);
+    }
+    return estimated == candidates.size();
+}
+
+// Simulates the selected candidates in detail, each in a forked process with a fresh SystemC kernel
+static void confirm_candidates(vector<Candidate> &candidates, const vector<size_t> &selected, int cycles,
+                               unsigned cacheLatency, int memoryLatency, size_t numRequests, Request requests[],
+                               const SimulationOptions* options, unsigned workers) {
+    struct Running {
+        pid_t pid;
+        int resultFd;
+        size_t index;
+    };
+    vector<Running> running;
+    size_t next = 0;
+
+    while (next < selected.size() || !running.empty()) {
+        if (next < selected.size() && running.size() < workers) {
+            size_t index = selected[next++];
+            int resultPipe[2];
+            if (pipe(resultPipe) != 0) {
+                continue;
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                close(resultPipe[0]);
+                close(resultPipe[1]);
+                continue;
+            }
+            if (pid == 0) {
+                close(resultPipe[0]);
+                int devNull = open("/dev/null", O_WRONLY);
+                if (devNull >= 0) {
+                    dup2(devNull, STDOUT_FILENO);
+                    close(devNull);
+                }
+
+                const Candidate &candidate = candidates[index];
+                SimulationOptions candidateOptions = *options;
+                candidateOptions.fullyAssociative = candidate.fullyAssociative;
+                SimulationStatistics* statistics = new SimulationStatistics();
+                DetailedRecord record = {};
+                record.result = run_simulation_with_options(cycles, candidate.directMapped, candidate.cacheLines,
+                                                            candidate.cacheLineSize, cacheLatency, memoryLatency,
+                                                            numRequests, requests, "", &candidateOptions, statistics);
+                LatencyHistogram all = {};
+                for (int latencyClass = 0; latencyClass < LATENCY_CLASSES; latencyClass++) {
+                    latency_merge(&all, &statistics->latency[latencyClass]);
+                }
+                record.amat = latency_mean(&all);
+                ssize_t written = write(resultPipe[1], &record, sizeof(record));
+                _exit(written == sizeof(record) ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            close(resultPipe[1]);
+            running.push_back({pid, resultPipe[0], index});
+            continue;
+        }
+
+        // All workers busy or nothing left to start: collect the next one to finish
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            break;
+        }
+        for (size_t i = 0; i < running.size(); i++) {
+            if (running[i].pid != pid) {
+                continue;
+            }
+            DetailedRecord record;
+            if (read(running[i].resultFd, &record, sizeof(record)) == sizeof(record)) {
+                Candidate &candidate = candidates[running[i].index];
+                candidate.result = record.result;
+                candidate.amat = record.amat;
+                candidate.confirmed = true;
+            } else {
+                cerr << "Error: Detailed simulation of candidate " << running[i].index << " failed" << endl;
+            }
+            close(running[i].resultFd);
+            running.erase(running.begin() + i);
+            break;
+        }
+    }
+}
+
+// Indices of the candidates no other candidate beats with fewer or equal gates, by ascending gates
+static vector<size_t> pareto_front(const vector<Candidate> &candidates, const vector<size_t> &indices,
+                                   double (*objective)(const Candidate&)) {
+    vector<size_t> sorted = indices;
+    sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+        if (candidates[a].gates != candidates[b].gates) {
+            return candidates[a].gates < candidates[b].gates;
+        }
+        return objective(candidates[a]) < objective(candidates[b]);
+    });
+
+    vector<size_t> front;
+    for (size_t index : sorted) {
+        if (front.empty() || objective(candidates[index]) < objective(candidates[front.back()])) {
+            front.push_back(index);
+        }
+    }
+    return front;
+}
+
+static double estimated(const Candidate &candidate) {
+    return candidate.estimate;
+}
+
+static double detailed_cycles(const Candidate &candidate) {
+    return static_cast<double>(candidate.result.cycles);
+}
+
+static double detailed_amat(const Candidate &candidate) {
+    return candidate.amat;
+}
+
+int run_autotune(int cycles, unsigned cacheLatency, int memoryLatency, size_t numRequests, Request requests[],
+                 const SimulationOptions* options, AutotuneObjective objective, size_t gateBudget,
+                 unsigned confirmCount, unsigned workers) {
+    // Forked processes must not write out what is still buffered here
+    fflush(stdout);
+    if (workers == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? static_cast<unsigned>(cores) : 1;
+    }
+
+    vector<Candidate> candidates = enumerate_candidates(options, gateBudget);
+    if (candidates.empty()) {
+        cerr << "Error: No cache configuration fits into " << gateBudget << " gates" << endl;
+        return EXIT_FAILURE;
+    }
+    if (!estimate_candidates(candidates, cacheLatency, static_cast<unsigned>(memoryLatency), numRequests, requests,
+                             options, objective, min<size_t>(workers, candidates.size()))) {
+        cerr << "Error: Functional estimation of the candidates failed" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Confirm the estimated Pareto front and the best confirmCount estimates in detail
+    vector<size_t> all(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        all[i] = i;
+    }
+    vector<size_t> selected = pareto_front(candidates, all, estimated);
+    vector<size_t> byEstimate = all;
+    sort(byEstimate.begin(), byEstimate.end(), [&](size_t a, size_t b) {
+        return candidates[a].estimate < candidates[b].estimate;
+    });
+    for (size_t i = 0; i < byEstimate.size() && i < confirmCount; i++) {
+        if (find(selected.begin(), selected.end(), byEstimate[i]) == selected.end()) {
+            selected.push_back(byEstimate[i]);
+        }
+    }
+    confirm_candidates(candidates, selected, cycles, cacheLatency, memoryLatency, numRequests, requests, options, workers);
+
+    // Runs that didn't finish within the given cycles don't compete
+    vector<size_t> finished;
+    for (size_t index : selected) {
+        if (candidates[index].confirmed && candidates[index].result.cycles < static_cast<size_t>(cycles)) {
+            finished.push_back(index);
+        }
+    }
+    printf("\nAutotune: %zu configurations within %zu gates, %zu simulated in detail, %zu finished\n",
+           candidates.size(), gateBudget, selected.size(), finished.size());
+    if (finished.empty()) {
+        cerr << "Error: No candidate finished within " << cycles << " cycles" << endl;
+        return EXIT_FAILURE;
+    }
+
+    double (*objectiveOf)(const Candidate&) = (objective == AUTOTUNE_AMAT) ? detailed_amat : detailed_cycles;
+    vector<size_t> front = pareto_front(candidates, finished, objectiveOf);
+    printf("Pareto Front (gates vs %s):\n", objective == AUTOTUNE_AMAT ? "AMAT" : "cycles");
+    for (size_t index : front) {
+        const Candidate &candidate = candidates[index];
+        printf("%-17s %5u x %3u Byte: %8u gates, %8zu cycles, AMAT %.2f, %zu misses (estimated %.2f)\n",
+               organization_name(candidate), candidate.cacheLines, candidate.cacheLineSize, candidate.gates,
+               candidate.result.cycles, candidate.amat, candidate.result.misses, candidate.estimate);
+    }
+
+    // The last point of the front is the best within the budget
+    const Candidate &best = candidates[front.back()];
+    printf("Best: --%s --cachelines %u --cacheline-size %u\n", organization_name(best), best.cacheLines, best.cacheLineSize);
+    return EXIT_SUCCESS;
+}
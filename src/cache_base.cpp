@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cstring>
+
 #include "../includes/cache_base.hpp"
+#include "../includes/main_memory_global.hpp"
+
+using namespace std;
 
 uint32_t CacheBase::merge_data_to_uint32(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t data4) {
     // Merge 4 bytes of data with consecutive offsets into a 32-bit-unsigned integer according to little-endian
@@ -8,4 +14,90 @@ uint32_t CacheBase::merge_data_to_uint32(uint8_t data1, uint8_t data2, uint8_t d
     result |= static_cast<uint32_t>(data2) << 8; 
     result |= static_cast<uint32_t>(data1); 
     return result;
-}
\ No newline at end of file
+}
+
+void CacheBase::read_span(uint32_t address, uint32_t size, uint8_t* dataToRead, CacheConfig cacheConfig, Result &result) {
+    access_span(address, size, dataToRead, false, cacheConfig, result);
+}
+
+void CacheBase::write_span(uint32_t address, uint32_t size, const uint8_t* dataToWrite, CacheConfig cacheConfig, Result &result) {
+    access_span(address, size, const_cast<uint8_t*>(dataToWrite), true, cacheConfig, result);
+}
+
+void CacheBase::access_span(uint32_t address, uint32_t size, uint8_t* data, bool write, CacheConfig cacheConfig, Result &result) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+
+    // Another access to the line of the previous one needs no lookup
+    if (repeats_line(address, size, cacheConfig)) {
+        uint8_t* lineData = &repeatLine.data[address & (lineSize - 1)];
+        if (write) {
+            memcpy(lineData, data, size);
+            mainMemory->write_span(address, data, size);
+        } else {
+            memcpy(data, lineData, size);
+        }
+        repeat_hits(1, result);
+        return;
+    }
+
+    Result lineResult = result;
+    AccessInfo spanAccess;
+    unsigned linesAccessed = 0;
+
+    // Copy the part of the span inside each line at once
+    for (uint32_t done = 0; done < size; linesAccessed++) {
+        uint32_t offset = (address + done) & (lineSize - 1);
+        uint32_t part = min(size - done, lineSize - offset);
+        uint8_t* lineData = access_line(address + done, part, cacheConfig, lineResult);
+
+        if (write) {
+            memcpy(&lineData[offset], &data[done], part);
+            mainMemory->write_span(address + done, &data[done], part);
+        } else {
+            memcpy(&data[done], &lineData[offset], part);
+        }
+
+        spanAccess.prefetchedHit |= lastAccess.prefetchedHit;
+        spanAccess.victimHit |= lastAccess.victimHit;
+        spanAccess.sectorMiss |= lastAccess.sectorMiss;
+        spanAccess.sectorsFetched += lastAccess.sectorsFetched;
+        done += part;
+    }
+    spanAccess.splitAccess = linesAccessed > 1;
+    lastAccess = spanAccess;
+
+    // The request misses if any of its lines missed
+    if (lineResult.misses > result.misses) {
+        result.misses++;
+    } else {
+        result.hits++;
+    }
+}
+
+uint64_t CacheBase::sector_mask(uint32_t offset, uint32_t size, CacheConfig cacheConfig) {
+    uint32_t firstSector = offset >> cacheConfig.numberOfSectorOffsetBits;
+    uint32_t lastSector = (offset + size - 1) >> cacheConfig.numberOfSectorOffsetBits;
+    uint64_t upToLast = (lastSector >= 63) ? ~0ULL : (1ULL << (lastSector + 1)) - 1;
+    return upToLast & ~((1ULL << firstSector) - 1);
+}
+
+uint64_t CacheBase::all_sectors(CacheConfig cacheConfig) {
+    uint32_t sectorsPerLine = 1u << (cacheConfig.numberOfOffsetBits - cacheConfig.numberOfSectorOffsetBits);
+    return (sectorsPerLine >= 64) ? ~0ULL : (1ULL << sectorsPerLine) - 1;
+}
+
+unsigned CacheBase::fetch_sectors(uint8_t* lineData, uint32_t lineAddress, uint64_t mask, CacheConfig cacheConfig) {
+    uint32_t sectorSize = 1u << cacheConfig.numberOfSectorOffsetBits;
+    uint32_t sectorsPerLine = 1u << (cacheConfig.numberOfOffsetBits - cacheConfig.numberOfSectorOffsetBits);
+    unsigned sectorsFetched = 0;
+
+    for (uint32_t sector = 0; sector < sectorsPerLine; sector++) {
+        if (!(mask & (1ULL << sector))) {
+            continue;
+        }
+        uint32_t sectorOffset = sector * sectorSize;
+        mainMemory->read_span(lineAddress + sectorOffset, &lineData[sectorOffset], sectorSize);
+        sectorsFetched++;
+    }
+    return sectorsFetched;
+}
@@ -1,17 +1,145 @@
+#include <algorithm>
+
 #include "../includes/cache_module.hpp"
 
 MainMemory* mainMemory = new MainMemory(CACHE_ADDRESS_LENGTH);
 
+CacheConfig cache_config(unsigned cacheLines, unsigned cacheLineSize, int directMapped, bool fullyAssociative, unsigned sectorSize) {
+    CacheConfig cacheConfig;
+    if (fullyAssociative) {
+        cacheConfig.numberOfIndexBits = 0;
+    } else {
+        cacheConfig.numberOfIndexBits = ceil(log2((directMapped == 1) ? cacheLines : cacheLines / 4));
+    }
+    cacheConfig.numberOfOffsetBits = ceil(log2(cacheLineSize));
+    cacheConfig.numberOfTagBits = CACHE_ADDRESS_LENGTH - cacheConfig.numberOfIndexBits - cacheConfig.numberOfOffsetBits;
+    cacheConfig.numberOfSectorOffsetBits = (sectorSize > 0) ? ceil(log2(sectorSize)) : cacheConfig.numberOfOffsetBits;
+    return cacheConfig;
+}
+
+CacheBase* create_cache(unsigned cacheLines, CacheConfig cacheConfig, int directMapped, bool fullyAssociative,
+                        unsigned victimEntries, SimulationStatistics* statistics, bool hugePages) {
+    if (fullyAssociative) {
+        return new FullyAssociativeCache(cacheLines, cacheConfig, hugePages);
+    } else if (directMapped == 0) {
+        return new FourWayLRUCache(cacheConfig, hugePages);
+    }
+    return new DirectMappedCache(cacheLines, cacheConfig, victimEntries, statistics, hugePages);
+}
+
+// Storage, tag comparison, control logic and replacement gates of a cache organization
+static uint32_t organization_gates(unsigned cacheLines, unsigned cacheLineSize, int directMapped, bool fullyAssociative,
+                                   CacheConfig cacheConfig) {
+    uint32_t oneBitStorageGates = 4;
+    uint32_t allBitsCacheStorageGates = (8 * oneBitStorageGates) * (cacheLines * cacheLineSize);
+    uint32_t controlLogicGates = 5 * cacheLines; 
+    uint32_t tagComparisonGates = (2 * cacheConfig.numberOfTagBits) * cacheLines;
+
+    uint32_t totalGates = allBitsCacheStorageGates + tagComparisonGates + controlLogicGates;
+
+    if (!directMapped && !fullyAssociative) {
+        uint32_t twoBitCounterGates = (2 * oneBitStorageGates) * cacheLines;
+        uint32_t comparatorForCounterGates = twoBitCounterGates * 2; // comparator = 2 gates
+        uint32_t updateLogicGates = twoBitCounterGates * 7; // 2-bit adder = HA (2) + VA (5) = 7 gates
+        uint32_t LRUGates = twoBitCounterGates + comparatorForCounterGates + updateLogicGates;
+        totalGates += LRUGates;
+    }
+
+    // Fully-associative: the tags form a CAM, every line compares the full line number and the match lines
+    // are encoded into the hit line. LRU counters of log2(cachelines) bits per line as for the victim buffer.
+    if (fullyAssociative) {
+        uint32_t counterBits = max(1, static_cast<int>(ceil(log2(cacheLines))));
+        uint32_t matchEncoderGates = counterBits * cacheLines;
+        uint32_t counterGates = (counterBits * oneBitStorageGates) * cacheLines;
+        uint32_t LRUGates = counterGates + counterGates * 2 + counterGates * 7;
+        totalGates += matchEncoderGates + LRUGates;
+    }
+    return totalGates;
+}
+
+uint32_t primitive_gate_count(int directMapped, bool fullyAssociative, unsigned cacheLines, unsigned cacheLineSize,
+                              const SimulationOptions* options) {
+    CacheConfig cacheConfig = cache_config(cacheLines, cacheLineSize, directMapped, fullyAssociative, options->sectorSize);
+    uint32_t sectorsPerLine = 1u << (cacheConfig.numberOfOffsetBits - cacheConfig.numberOfSectorOffsetBits);
+    uint32_t oneBitStorageGates = 4;
+    uint32_t totalGates = organization_gates(cacheLines, cacheLineSize, directMapped, fullyAssociative, cacheConfig);
+    if (options->icacheLines > 0) {
+        CacheConfig instructionConfig = cache_config(options->icacheLines, options->icacheLineSize, options->icacheDirectMapped,
+                                                     options->icacheFullyAssociative, 0);
+        totalGates += organization_gates(options->icacheLines, options->icacheLineSize, options->icacheDirectMapped,
+                                         options->icacheFullyAssociative, instructionConfig);
+    }
+
+    // TLBs: virtual page number storage and comparator per entry, LRU counters per entry as for the victim buffer
+    if (options->mmu) {
+        uint32_t virtualPageBits = max(1, CACHE_ADDRESS_LENGTH - static_cast<int>(log2(options->pageSize)));
+        uint32_t tlbEntries[2] = {options->l1TlbEntries, options->l2TlbEntries};
+        uint32_t tlbWays[2] = {options->l1TlbWays, options->l2TlbWays};
+        for (int level = 0; level < 2; level++) {
+            uint32_t counterBits = max(1, static_cast<int>(ceil(log2(max(tlbWays[level], 1u)))));
+            uint32_t entryStorageGates = ((virtualPageBits + 1) * oneBitStorageGates) * tlbEntries[level];
+            uint32_t entryComparisonGates = (2 * virtualPageBits) * tlbEntries[level];
+            uint32_t counterGates = (counterBits * oneBitStorageGates) * tlbEntries[level];
+            totalGates += entryStorageGates + entryComparisonGates + counterGates + counterGates * 2 + counterGates * 7;
+        }
+    }
+
+    // Way partitioning: a way mask register per stream with a bit per way of a set, the mask gates the LRU victim of every line
+    bool partitioned = false;
+    for (unsigned stream = 0; stream < MAX_STREAMS; stream++) {
+        partitioned = partitioned || options->wayMasks[stream] != 0;
+    }
+    if (partitioned) {
+        totalGates += (MAX_STREAMS * cacheConfig.numberOfTagBits * oneBitStorageGates) + cacheLines;
+    }
+
+    // Store buffer: a line of data with a written bit per byte and a line-number comparator per entry
+    if (options->storeBufferEntries > 0) {
+        uint32_t storeBufferEntries = options->storeBufferEntries;
+        uint32_t lineBytes = 1u << cacheConfig.numberOfOffsetBits;
+        uint32_t lineNumberBits = CACHE_ADDRESS_LENGTH - cacheConfig.numberOfOffsetBits;
+        uint32_t bufferStorageGates = (9 * oneBitStorageGates) * (storeBufferEntries * lineBytes);
+        uint32_t bufferAddressGates = (lineNumberBits * oneBitStorageGates + 2 * lineNumberBits) * storeBufferEntries;
+        totalGates += bufferStorageGates + bufferAddressGates + 5 * storeBufferEntries;
+    }
+
+    // Sectored lines need a valid bit per sector
+    if (sectorsPerLine > 1) {
+        totalGates += (sectorsPerLine * oneBitStorageGates) * cacheLines;
+    }
+
+    // Fully-associative victim buffer: full line-number comparator per entry, LRU counters as for 4-way
+    if (directMapped && options->victimEntries > 0) {
+        uint32_t victimEntries = options->victimEntries;
+        uint32_t lineNumberBits = cacheConfig.numberOfTagBits + cacheConfig.numberOfIndexBits;
+        uint32_t counterBits = max(1, static_cast<int>(ceil(log2(victimEntries))));
+        uint32_t victimStorageGates = (8 * oneBitStorageGates) * (victimEntries * cacheLineSize);
+        uint32_t victimControlLogicGates = 5 * victimEntries;
+        uint32_t victimComparisonGates = (2 * lineNumberBits) * victimEntries;
+        uint32_t victimCounterGates = (counterBits * oneBitStorageGates) * victimEntries;
+        uint32_t victimLRUGates = victimCounterGates + victimCounterGates * 2 + victimCounterGates * 7;
+        totalGates += victimStorageGates + victimControlLogicGates + victimComparisonGates + victimLRUGates;
+    }
+    return totalGates;
+}
+
 CACHE_MODULE::CACHE_MODULE(sc_module_name name, int cycles, int directMapped, unsigned cacheLines, unsigned cacheLineSize,
-                unsigned cacheLatency, unsigned memoryLatency, int numRequests) : sc_module(name) {
+                unsigned cacheLatency, unsigned memoryLatency, int numRequests,
+                const SimulationOptions* options, SimulationStatistics* statistics)
+                : sc_module(name), targetSocket("targetSocket"), fetchTargetSocket("fetchTargetSocket"), memorySocket("memorySocket"),
+                  requestQueue("requestQueue", options->queueDepth > 0 ? options->queueDepth : 16) {
         
     this->cycles = cycles;
     this->directMapped = directMapped;
+    this->fullyAssociative = options->fullyAssociative;
     this->cacheLines = cacheLines;
     this->cacheLineSize = cacheLineSize;
     this->cacheLatency = cacheLatency;
     this->memoryLatency = memoryLatency;
     this->numRequests = numRequests; 
+    this->victimLatency = options->victimLatency > 0 ? options->victimLatency : cacheLatency;
+    this->victimEntries = options->victimEntries;
+    this->statistics = statistics;
 
     waitForCacheLatency.write(0);
     waitForMemoryLatency.write(0);
@@ -23,37 +151,516 @@ CACHE_MODULE::CACHE_MODULE(sc_module_name name, int cycles, int directMapped, un
     resultTemp.primitiveGateCount = 0;
 
     // Determine number of index, offset, tag
-    cacheConfig.numberOfIndexBits = ceil(log2((directMapped == 1) ? cacheLines : cacheLines / 4));
-    cacheConfig.numberOfOffsetBits = ceil(log2(cacheLineSize));
-    cacheConfig.numberOfTagBits = CACHE_ADDRESS_LENGTH - cacheConfig.numberOfIndexBits - cacheConfig.numberOfOffsetBits;
+    cacheConfig = cache_config(cacheLines, cacheLineSize, directMapped, fullyAssociative, options->sectorSize);
+    sectorsPerLine = 1u << (cacheConfig.numberOfOffsetBits - cacheConfig.numberOfSectorOffsetBits);
 
     // Polymorphic implementation of cache
-    if (directMapped == 0) {
-        cache = new FourWayLRUCache(cacheConfig);
-    } else {
-        cache = new DirectMappedCache(cacheLines, cacheConfig);
+    cache = create_cache(cacheLines, cacheConfig, directMapped, fullyAssociative, options->victimEntries, statistics, options->hugePages);
+
+    // Split instruction cache with its own geometry and latency, its misses are filled from the same main memory
+    instructionCache = nullptr;
+    instructionLines = options->icacheLines;
+    instructionLineSize = options->icacheLineSize;
+    instructionLatency = options->icacheLatency;
+    fetchAccess = false;
+    requestStarting = true;
+    if (instructionLines > 0) {
+        instructionConfig = cache_config(instructionLines, instructionLineSize, options->icacheDirectMapped,
+                                         options->icacheFullyAssociative, 0);
+        instructionCache = create_cache(instructionLines, instructionConfig, options->icacheDirectMapped,
+                                        options->icacheFullyAssociative, 0, nullptr, options->hugePages);
+    }
+
+    // Optional prefetcher observing the demand accesses
+    prefetcher = Prefetcher::create(options->prefetcher, cache, cacheConfig, memoryLatency, 1u << CACHE_ADDRESS_LENGTH,
+                                    options->prefetchDegree, statistics);
+
+    // DRAM timing model replacing the constant memoryLatency of misses, and the bus the fills are transferred on
+    dram = options->dram ? new DramController(options, statistics) : nullptr;
+    bus = (options->busWidth > 0) ? new MemoryBus(options, statistics) : nullptr;
+    if (prefetcher && (dram || bus)) {
+        prefetcher->set_memory_fill([this](uint32_t address, uint32_t bytes, unsigned latency, size_t cycle) {
+            return memory_fill(address, bytes, latency, cycle);
+        });
+    }
+
+    // Address translation in front of the cache, the page walks read the page tables through it
+    mmu = options->mmu ? new MMU(options, 1u << CACHE_ADDRESS_LENGTH, statistics,
+                                 [this](uint32_t address, size_t cycle) { return walk_load(address, cycle); }) : nullptr;
+    translationCycles = 0;
+    translatedAddress = 0;
+    functionalWarming = false;
+
+    // Non-blocking cache if MSHRs are configured, otherwise every miss blocks the cache
+    mshrs = (options->mshrs > 0) ? new MissStatusHoldingRegisters(options->mshrs, statistics) : nullptr;
+
+    // Write-combining store buffer, an entry is written to the main memory over the same DRAM and bus as a fill
+    storeBuffer = nullptr;
+    bufferedStore = false;
+    accessSize = 0;
+    if (options->storeBufferEntries > 0) {
+        storeBuffer = new StoreBuffer(options->storeBufferEntries, 1u << cacheConfig.numberOfOffsetBits, statistics,
+                                      [this, memoryLatency](uint32_t address, uint32_t bytes, size_t cycle) {
+            unsigned latency = dram ? dram->access(address, cycle) : memoryLatency;
+            if (bus) {
+                bus->write(cycle, bytes);
+            }
+            return latency;
+        });
+    }
+
+    // Way partitioning of the 4-way cache
+    for (unsigned stream = 0; stream < MAX_STREAMS; stream++) {
+        cache->partition.wayMasks[stream] = options->wayMasks[stream];
     }
 
     // primitiveGateCount
-    uint32_t oneBitStorageGates = 4;
-    uint32_t allBitsCacheStorageGates = (8 * oneBitStorageGates) * (cacheLines * cacheLineSize);
-    uint32_t controlLogicGates = 5 * cacheLines; 
-    uint32_t tagComparisonGates = (2 * cacheConfig.numberOfTagBits) * cacheLines;
+    totalGates = primitive_gate_count(directMapped, fullyAssociative, cacheLines, cacheLineSize, options);
 
-    totalGates = allBitsCacheStorageGates + tagComparisonGates + controlLogicGates;
+    // Queued mode with issue width and cache ports
+    issueWidth = options->issueWidth;
+    cachePorts = options->cachePorts > 0 ? options->cachePorts : 1;
+    portsBlockedUntil = 0;
+    lastCompleteCycle = 0;
+    processedRequests = 0;
 
-    if (!directMapped) {
-        uint32_t twoBitCounterGates = (2 * oneBitStorageGates) * cacheLines;
-        uint32_t comparatorForCounterGates = twoBitCounterGates * 2; // comparator = 2 gates
-        uint32_t updateLogicGates = twoBitCounterGates * 7; // 2-bit adder = HA (2) + VA (5) = 7 gates
-        uint32_t LRUGates = twoBitCounterGates + comparatorForCounterGates + updateLogicGates;
-        totalGates += LRUGates;
+    fsmState = IDLE;
+    tagCounter = cacheLatency;
+    memoryCounter = 0;
+    fsmDataRead = 0;
+    fsmEdges = 0;
+    fsmStartCycle = 0;
+    fsmMiss = false;
+
+    targetSocket.register_b_transport(this, &CACHE_MODULE::b_transport);
+    fetchTargetSocket.register_b_transport(this, &CACHE_MODULE::b_transport_fetch);
+    memorySocket.register_invalidate_direct_mem_ptr(this, &CACHE_MODULE::invalidate_direct_mem_ptr);
+    memoryDmiValid = false;
+    lineBuffer.resize(cacheLineSize);
+
+    // Loosely-timed mode: no clocked process, the cache only works when a transaction arrives
+    if (options->tlm) {
+        resultTemp.primitiveGateCount = totalGates;
+        return;
     }
 
-    SC_THREAD(update);
+    if (issueWidth > 0) {
+        requestTimings.resize(numRequests);
+        SC_THREAD(update_queued);
+    } else if (options->threadEngine) {
+        SC_THREAD(update);
+    } else {
+        // The thread catches the edge at time 0 with its initial run, the method only runs on edges
+        SC_METHOD(update_fsm);
+        dont_initialize();
+    }
     sensitive << clk.pos();
 }
 
+CACHE_MODULE::~CACHE_MODULE() {
+    delete prefetcher;
+    delete mshrs;
+    delete storeBuffer;
+    delete dram;
+    delete bus;
+    delete mmu;
+    delete instructionCache;
+}
+
+void CACHE_MODULE::record_latency(bool write, bool miss, size_t cycles) {
+    LatencyClass latencyClass = write ? (miss ? LATENCY_WRITE_MISS : LATENCY_WRITE_HIT) : (miss ? LATENCY_READ_MISS : LATENCY_READ_HIT);
+    latency_record(&statistics->latency[latencyClass], cycles);
+}
+
+void CACHE_MODULE::drain() {
+    if (resultTemp.cycles == SIZE_MAX - 1) {
+        return;
+    }
+
+    // The store buffer writes back in parallel to the outstanding fills. Completion stamps of the
+    // queued mode already include the outstanding fills.
+    size_t storeCycles = storeBuffer ? storeBuffer->drain(resultTemp.cycles) : 0;
+    size_t fillCycles = (mshrs && issueWidth == 0) ? mshrs->drain(resultTemp.cycles) : 0;
+    resultTemp.cycles += max(storeCycles, fillCycles);
+}
+
+bool CACHE_MODULE::save_checkpoint(const char* path) {
+    CheckpointHeader header = {CHECKPOINT_MAGIC, CHECKPOINT_VERSION, static_cast<uint32_t>(directMapped), cacheLines, cacheLineSize,
+                               static_cast<uint32_t>(cacheConfig.numberOfSectorOffsetBits), victimEntries, CACHE_ADDRESS_LENGTH,
+                               static_cast<uint32_t>(fullyAssociative)};
+    CheckpointWriter writer;
+    writer.put(header);
+    cache->save_state(writer, cacheConfig);
+    mainMemory->save_pages(writer);
+    return writer.write_to_file(path);
+}
+
+bool CACHE_MODULE::load_checkpoint(const char* path) {
+    CheckpointReader reader(path);
+    if (!reader.is_open()) {
+        cerr << "Error: Can't open checkpoint " << path << endl;
+        return false;
+    }
+
+    CheckpointHeader header = reader.get<CheckpointHeader>();
+    if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION) {
+        cerr << "Error: " << path << " is not a checkpoint of this simulator version" << endl;
+        return false;
+    }
+    if (header.directMapped != static_cast<uint32_t>(directMapped) || header.cacheLines != cacheLines ||
+        header.cacheLineSize != cacheLineSize || header.numberOfSectorOffsetBits != static_cast<uint32_t>(cacheConfig.numberOfSectorOffsetBits) ||
+        header.victimEntries != victimEntries || header.addressLength != CACHE_ADDRESS_LENGTH ||
+        header.fullyAssociative != static_cast<uint32_t>(fullyAssociative)) {
+        cerr << "Error: Checkpoint " << path << " was taken from a different cache configuration" << endl;
+        return false;
+    }
+
+    if (!cache->load_state(reader, cacheConfig) || !mainMemory->load_pages(reader)) {
+        cerr << "Error: Checkpoint " << path << " is truncated" << endl;
+        return false;
+    }
+    return true;
+}
+
+void CACHE_MODULE::translate(uint32_t &address, size_t cycle) {
+    translationCycles = 0;
+    if (mmu) {
+        uint32_t physicalAddress;
+        translationCycles = mmu->translate(address, physicalAddress, cycle);
+        address = physicalAddress;
+    }
+    translatedAddress = address;
+}
+
+unsigned CACHE_MODULE::walk_load(uint32_t address, size_t cycle) {
+    // Page-table reads are no demand accesses, they are counted as walk loads instead of hits or misses
+    Result walkResult = resultTemp;
+    size_t victimHits = statistics->victimHits;
+    uint8_t entry[PAGE_TABLE_ENTRY_SIZE];
+    cache->read_span(address, PAGE_TABLE_ENTRY_SIZE, entry, cacheConfig, walkResult);
+    const AccessInfo access = cache->lastAccess;
+    bool miss = walkResult.misses > resultTemp.misses;
+    statistics->walkLoadMisses += miss ? 1 : 0;
+    statistics->walkLoadVictimHits += statistics->victimHits - victimHits;
+    statistics->victimHits = victimHits;
+    if (functionalWarming) {
+        return cacheLatency + (miss ? memoryLatency : 0);
+    }
+
+    // Same fill as a demand miss, started once the lookup is done
+    size_t fillCycle = cycle + cacheLatency;
+    unsigned penalty = 0;
+    if (miss) {
+        statistics->sectorsFetched += access.sectorsFetched;
+        unsigned fillLatency = bus ? memoryLatency : (memoryLatency * access.sectorsFetched + sectorsPerLine - 1) / sectorsPerLine;
+        penalty = memory_fill(address, access.sectorsFetched << cacheConfig.numberOfSectorOffsetBits, fillLatency, fillCycle);
+    }
+    if (access.victimHit) {
+        penalty = max(penalty, victimLatency);
+    }
+
+    // Unlike a demand miss the walk can't go on before the entry arrives, so it waits for the fill
+    // of its line in any case
+    if (mshrs) {
+        uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+        size_t readyCycle;
+        if (mshrs->merge(lineAddress, fillCycle, &readyCycle)) {
+            penalty = max(penalty, static_cast<unsigned>(readyCycle - fillCycle));
+        } else if (miss) {
+            penalty += mshrs->allocate(lineAddress, fillCycle, penalty);
+        }
+    }
+    return cacheLatency + penalty;
+}
+
+unsigned CACHE_MODULE::tag_latency(bool fetch, bool write) {
+    if (fetch && instructionCache) {
+        return instructionLatency;
+    }
+    return (write && storeBuffer) ? 0 : cacheLatency;
+}
+
+uint32_t CACHE_MODULE::access(uint32_t address, uint32_t dataToWrite, unsigned size, bool write, size_t cycle, bool fetch,
+                              unsigned stream) {
+    size_t currentHits = resultTemp.hits;
+    size_t currentMisses = resultTemp.misses;
+
+    // The walk of a TLB miss reads the page tables through the cache before the access itself
+    cache->partition.stream = stream;
+    translate(address, cycle);
+    size = (size == 0) ? 4 : size;
+    uint32_t offset = address & ((1u << cacheConfig.numberOfOffsetBits) - 1);
+    fetchAccess = fetch && !write && instructionCache;
+    bufferedStore = write && storeBuffer;
+    accessSize = size;
+
+    // 4-byte accesses inside a line keep the original path, unless they stay in the line of the previous access
+    uint32_t dataRead = 0;
+    if (!fetchAccess && size == 4 && offset + 4 <= (1u << cacheConfig.numberOfOffsetBits) &&
+        !cache->repeats_line(address, size, cacheConfig)) {
+        if (write) {
+            cache->write_to_cache(address, cacheConfig, dataToWrite, resultTemp);
+        } else {
+            dataRead = cache->read_from_cache(address, cacheConfig, resultTemp);
+        }
+        count_stream(stream, currentHits, currentMisses);
+        return dataRead;
+    }
+
+    // Wide, line-crossing or repeated access, the 32-bit write data is repeated over the span
+    uint8_t span[MAX_ACCESS_SIZE];
+    for (unsigned i = 0; write && i < size; i++) {
+        span[i] = static_cast<uint8_t>((dataToWrite >> (8 * (i % 4))) & 0xFF);
+    }
+    access_bytes(address, span, size, write);
+    for (unsigned i = 0; !write && i < size && i < 4; i++) {
+        dataRead |= static_cast<uint32_t>(span[i]) << (8 * i);
+    }
+    count_stream(stream, currentHits, currentMisses);
+    return dataRead;
+}
+
+void CACHE_MODULE::count_stream(unsigned stream, size_t currentHits, size_t currentMisses) {
+    statistics->streamHits[stream] += resultTemp.hits - currentHits;
+    statistics->streamMisses[stream] += resultTemp.misses - currentMisses;
+    for (unsigned owner = 0; owner < MAX_STREAMS; owner++) {
+        statistics->streamOccupancy[owner] += cache->partition.linesOwned[owner];
+    }
+    statistics->occupancySamples++;
+}
+
+void CACHE_MODULE::access_bytes(uint32_t address, uint8_t* bytes, unsigned size, bool write) {
+    // Instruction fetches only read, the instruction cache is not kept coherent with data writes
+    if (fetchAccess) {
+        size_t currentHits = resultTemp.hits;
+        size_t currentMisses = resultTemp.misses;
+        instructionCache->read_span(address, size, bytes, instructionConfig, resultTemp);
+        statistics->instructionHits += resultTemp.hits - currentHits;
+        statistics->instructionMisses += resultTemp.misses - currentMisses;
+        return;
+    }
+    if (write) {
+        cache->write_span(address, size, bytes, cacheConfig, resultTemp);
+    } else {
+        cache->read_span(address, size, bytes, cacheConfig, resultTemp);
+    }
+    if (cache->lastAccess.splitAccess) {
+        statistics->splitAccesses++;
+    }
+}
+
+void CACHE_MODULE::b_transport(tlm::tlm_generic_payload &transaction, sc_time &delay) {
+    transport(transaction, delay, false);
+}
+
+void CACHE_MODULE::b_transport_fetch(tlm::tlm_generic_payload &transaction, sc_time &delay) {
+    transport(transaction, delay, true);
+}
+
+void CACHE_MODULE::transport(tlm::tlm_generic_payload &transaction, sc_time &delay, bool fetch) {
+    uint64_t address = transaction.get_address();
+    unsigned size = transaction.get_data_length();
+    if (size == 0 || size > MAX_ACCESS_SIZE || address + size > (1u << CACHE_ADDRESS_LENGTH)) {
+        transaction.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+        return;
+    }
+    if (transaction.get_byte_enable_ptr() || transaction.get_streaming_width() < size) {
+        transaction.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+        return;
+    }
+    if (!transaction.is_read() && !transaction.is_write()) {
+        transaction.set_response_status(tlm::TLM_COMMAND_ERROR_RESPONSE);
+        return;
+    }
+
+    // The request starts at the local time of the initiator and accesses the cache after its tag latency
+    unsigned latency = tag_latency(fetch, transaction.is_write());
+    size_t cycle = static_cast<size_t>((sc_time_stamp() + delay) / CYCLE_TIME) + latency;
+    if (mshrs) {
+        mshrs->tick(cycle);
+    }
+    if (storeBuffer) {
+        storeBuffer->tick(cycle);
+    }
+
+    // The stream travels as an extension of the payload, transactions without one belong to stream 0
+    StreamExtension* streamExtension = transaction.get_extension<StreamExtension>();
+    unsigned stream = (streamExtension && streamExtension->stream < MAX_STREAMS) ? streamExtension->stream : 0;
+
+    bool write = transaction.is_write();
+    size_t currentHits = resultTemp.hits;
+    size_t currentMisses = resultTemp.misses;
+    uint32_t physicalAddress = static_cast<uint32_t>(address);
+    cache->partition.stream = stream;
+    translate(physicalAddress, cycle);
+    fetchAccess = fetch && !write && instructionCache;
+    bufferedStore = write && storeBuffer;
+    accessSize = size;
+    access_bytes(physicalAddress, transaction.get_data_ptr(), size, write);
+    count_stream(stream, currentHits, currentMisses);
+    bool miss = resultTemp.misses > currentMisses;
+    unsigned penalty = memory_penalty(physicalAddress, miss, miss ? memory_latency(physicalAddress) : memoryLatency,
+                                      write ? size : 0, cycle);
+
+    // Non-blocking: the fill is handed over to an MSHR, the request only waits if all MSHRs are busy
+    // or its line is still on its way
+    if (mshrs && !fetchAccess && !bufferedStore) {
+        penalty = mshr_stall(physicalAddress, miss, penalty, cycle);
+    }
+
+    // A TLB miss holds the request for its translation, also in the non-blocking cache
+    penalty += translationCycles;
+
+    // Same cycles as the blocking pin-level model: the tag latency, the memory penalty and the access cycle
+    delay += CYCLE_TIME * (latency + penalty + 1);
+    resultTemp.cycles = cycle + penalty + 1;
+
+    // As in the pin-level engines, a request that ends beyond the simulated cycles hasn't finished
+    if (resultTemp.cycles < static_cast<size_t>(cycles)) {
+        record_latency(write, miss, latency + penalty + 1);
+    }
+    transaction.set_response_status(tlm::TLM_OK_RESPONSE);
+}
+
+void CACHE_MODULE::invalidate_direct_mem_ptr(sc_dt::uint64 startAddress, sc_dt::uint64 endAddress) {
+    if (startAddress <= memoryDmi.get_end_address() && endAddress >= memoryDmi.get_start_address()) {
+        memoryDmiValid = false;
+    }
+}
+
+unsigned CACHE_MODULE::memory_latency(uint32_t address) {
+    uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+    if (memoryDmiValid && memoryDmi.is_read_allowed() && lineAddress >= memoryDmi.get_start_address() &&
+        lineAddress + cacheLineSize - 1 <= memoryDmi.get_end_address()) {
+        return static_cast<unsigned>(memoryDmi.get_read_latency() / CYCLE_TIME);
+    }
+
+    // Without DMI the line is read through the socket, the annotated delay is the latency
+    tlm::tlm_generic_payload transaction;
+    transaction.set_command(tlm::TLM_READ_COMMAND);
+    transaction.set_address(lineAddress);
+    transaction.set_data_ptr(lineBuffer.data());
+    transaction.set_data_length(cacheLineSize);
+    transaction.set_streaming_width(cacheLineSize);
+    transaction.set_byte_enable_ptr(nullptr);
+    transaction.set_dmi_allowed(false);
+    transaction.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+    sc_time delay = SC_ZERO_TIME;
+    memorySocket->b_transport(transaction, delay);
+    if (transaction.is_response_error()) {
+        cerr << "Error: Memory read of line " << lineAddress << " failed" << endl;
+        return memoryLatency;
+    }
+    if (transaction.is_dmi_allowed()) {
+        memoryDmiValid = memorySocket->get_direct_mem_ptr(transaction, memoryDmi);
+    }
+    return static_cast<unsigned>(delay / CYCLE_TIME);
+}
+
+uint32_t CACHE_MODULE::functional_access(const Request &request) {
+    functionalWarming = true;
+    uint32_t dataRead = access(request.addr, request.data, request.size, request.we, resultCycles.read(), request.fetch,
+                               request.stream);
+    functionalWarming = false;
+    resultHits.write(resultTemp.hits);
+    resultMisses.write(resultTemp.misses);
+    return dataRead;
+}
+
+unsigned CACHE_MODULE::memory_fill(uint32_t address, uint32_t bytes, unsigned latency, size_t cycle) {
+    unsigned fillLatency = dram ? dram->access(address, cycle) : latency;
+    if (bus) {
+        fillLatency = bus->read(cycle + fillLatency, bytes) - cycle;
+    }
+    return fillLatency;
+}
+
+unsigned CACHE_MODULE::memory_penalty(uint32_t address, bool miss, unsigned memoryLatency, uint32_t writeBytes, size_t cycle) {
+    // Instruction cache lines are filled whole, without prefetcher, sectors or victim buffer
+    if (fetchAccess) {
+        return miss ? memory_fill(address, instructionLineSize, memoryLatency, cycle) : 0;
+    }
+
+    const AccessInfo access = cache->lastAccess;
+
+    // Load misses whose bytes are all still in the store buffer are served from it
+    bool forwarded = miss && storeBuffer && !bufferedStore && storeBuffer->forwards(translatedAddress, accessSize, cycle);
+    statistics->storeBufferForwards += forwarded ? 1 : 0;
+
+    // Sectored lines only fetch the missing sectors. Without a bus model the fill latency scales with
+    // the fetched part of the line, with a bus the transfer time does.
+    unsigned fillLatency = memoryLatency;
+    if (miss) {
+        statistics->sectorsFetched += access.sectorsFetched;
+        statistics->sectorMisses += access.sectorMiss ? 1 : 0;
+        if (!bus) {
+            fillLatency = (memoryLatency * access.sectorsFetched + sectorsPerLine - 1) / sectorsPerLine;
+        }
+
+        // Misses served by a stream buffer don't go to the main memory
+        uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+        if (!(prefetcher && prefetcher->holds_line(lineAddress))) {
+            uint32_t bytes = access.sectorsFetched << cacheConfig.numberOfSectorOffsetBits;
+            fillLatency = memory_fill(address, bytes, fillLatency, cycle);
+        }
+    }
+
+    // Write-through data shares the bus with the fills, buffered stores only use it when their entry drains
+    if (bus && writeBytes > 0 && !storeBuffer) {
+        bus->write(cycle, writeBytes);
+    }
+
+    unsigned penalty = miss ? fillLatency : 0;
+    if (prefetcher) {
+        penalty = prefetcher->access(address, miss, access.prefetchedHit, cycle, fillLatency);
+    }
+
+    // A line swapped in from the victim buffer is slower than a hit but doesn't go to the main memory
+    if (access.victimHit) {
+        penalty = max(penalty, victimLatency);
+    }
+
+    // Write-allocate: a buffered store or a forwarded load still installs the whole line, but doesn't wait
+    // for its fill. The fill is remembered instead, a later load that hits the line waits for the rest of it.
+    uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+    if (miss && (bufferedStore || forwarded)) {
+        if (pendingFills.size() >= cacheLines) {
+            for (auto it = pendingFills.begin(); it != pendingFills.end();) {
+                it = (it->second <= cycle) ? pendingFills.erase(it) : next(it);
+            }
+        }
+        pendingFills[lineAddress] = cycle + penalty;
+        penalty = 0;
+    } else if (!pendingFills.empty()) {
+        auto pending = pendingFills.find(lineAddress);
+        if (pending != pendingFills.end()) {
+            if (!miss && !bufferedStore && pending->second > cycle) {
+                penalty = max(penalty, static_cast<unsigned>(pending->second - cycle));
+            }
+            if (miss || pending->second <= cycle) {
+                pendingFills.erase(pending);
+            }
+        }
+    }
+
+    // A buffered store only waits for room in the store buffer
+    if (bufferedStore) {
+        return storeBuffer->store(translatedAddress, accessSize, cycle);
+    }
+    return penalty;
+}
+
+unsigned CACHE_MODULE::mshr_stall(uint32_t address, bool miss, unsigned penalty, size_t cycle) {
+    uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+    if (miss || penalty > 0) {
+        return mshrs->allocate(lineAddress, cycle, penalty);
+    }
+    size_t readyCycle = cycle;
+    mshrs->merge(lineAddress, cycle, &readyCycle);
+    return static_cast<unsigned>(readyCycle - cycle);
+}
+
 void CACHE_MODULE::update() {
     // Update primitiveGateCount based on calculated totalGates in constructor
     wait(SC_ZERO_TIME);
@@ -63,14 +670,30 @@ void CACHE_MODULE::update() {
 
     unsigned cacheLatencyTemp = cacheLatency;
     unsigned memoryLatencyTemp = memoryLatency;
+    size_t requestStartCycle = 0;
+    bool requestMissed = false;
     
     for (int i = 0; i < cycles; i++){
+        if (mshrs) {
+            mshrs->tick(resultCycles.read());
+        }
+        if (storeBuffer) {
+            storeBuffer->tick(resultCycles.read());
+        }
+
         // If not all requests could be processed within the given cycles, cycles should have the value SIZE_MAX
         if (requestsExceedCycles.read()) {
             resultCycles.write(SIZE_MAX - 1);
             resultTemp.cycles = SIZE_MAX - 1;
         }
 
+        // A new request counts down the tag latency of the cache it goes to, between requests
+        // cacheLatency is back at its configured value
+        if (requestStarting) {
+            cacheLatency = tag_latency(requestFetch.read(), requestWE.read());
+            requestStarting = false;
+        }
+
         // Wait for cacheLatency cycles to complete before accessing the cache, and reset once completed
         if (cacheLatency > 0 && !waitForMemoryLatency.read()) {
             cacheLatency--;
@@ -88,20 +711,35 @@ void CACHE_MODULE::update() {
         // Besides cacheLatency, wait for memoryLatency as well before proceeding
         uint32_t dataToWriteTemp;
         size_t currentMisses = resultMisses;
+        unsigned penalty = 0;
+        bool accessed = false;
         wait(SC_ZERO_TIME);
         if (!waitForMemoryLatency.read()) {
-            if (requestWE) {
-                cache->write_to_cache(requestAddr, cacheConfig, requestData, resultTemp);
-            } else {
-                dataToWriteTemp = cache->read_from_cache(requestAddr, cacheConfig, resultTemp);
-            }
+            dataToWriteTemp = access(requestAddr, requestData, requestSize, requestWE, resultCycles.read(), requestFetch,
+                                     requestStream);
+            penalty = memory_penalty(translatedAddress, resultTemp.misses > currentMisses, memoryLatencyTemp,
+                                     requestWE ? (requestSize ? requestSize : 4) : 0, resultCycles.read());
+            accessed = true;
+            requestMissed = resultTemp.misses > currentMisses;
             resultHits.write(resultTemp.hits);
             resultMisses.write(resultTemp.misses);
             wait(SC_ZERO_TIME);
         }
 
-        // Detect cache miss
-        if (resultTemp.misses > currentMisses) {
+        // Non-blocking: the fill is handed over to an MSHR, the request only waits if all MSHRs are busy
+        // or its line is still on its way
+        if (mshrs && accessed && !fetchAccess && !bufferedStore) {
+            penalty = mshr_stall(translatedAddress, resultTemp.misses > currentMisses, penalty, resultCycles.read());
+        }
+
+        // A TLB miss holds the request for its translation, also in the non-blocking cache
+        if (accessed) {
+            penalty += translationCycles;
+        }
+
+        // Detect cache miss, or a hit on a prefetched line that is still on its way
+        if (resultTemp.misses > currentMisses || penalty > 0) {
+            memoryLatency = penalty;
             waitForMemoryLatency.write(1);
             wait(SC_ZERO_TIME);
         }
@@ -130,6 +768,202 @@ void CACHE_MODULE::update() {
         resultCycles.write(resultCycles.read() + 1);  
         wait(SC_ZERO_TIME);  
         resultTemp.cycles = resultCycles.read();
+        if (!requestsExceedCycles.read()) {
+            record_latency(requestWE, requestMissed, resultTemp.cycles - requestStartCycle);
+        }
+        requestStartCycle = resultTemp.cycles;
+        requestStarting = true;
         wait(); 
     }
 }
+
+void CACHE_MODULE::update_fsm() {
+    // Update primitiveGateCount based on calculated totalGates in constructor
+    if (fsmEdges == 0) {
+        resultPrimitiveGateCount.write(totalGates);
+        resultTemp.primitiveGateCount = totalGates;
+    }
+    if (fsmEdges++ >= cycles) {
+        return;
+    }
+
+    // Signals written in the previous edge are settled, the ones written here are visible after this edge
+    size_t cycle = resultCycles.read();
+    if (mshrs) {
+        mshrs->tick(cycle);
+    }
+    if (storeBuffer) {
+        storeBuffer->tick(cycle);
+    }
+
+    // If not all requests could be processed within the given cycles, cycles should have the value SIZE_MAX
+    bool requestsExceeded = requestsExceedCycles.read();
+    if (requestsExceeded) {
+        resultTemp.cycles = SIZE_MAX - 1;
+    }
+
+    if (fsmState == IDLE) {
+        fsmStartCycle = cycle;
+        tagCounter = tag_latency(requestFetch.read(), requestWE.read());
+    }
+
+    if (fsmState == IDLE || fsmState == TAG) {
+        // Wait for cacheLatency cycles to complete before accessing the cache
+        if (tagCounter > 0) {
+            tagCounter--;
+            fsmState = TAG;
+            resultCycles.write(cycle + 1);
+            waitForCacheLatency.write(1);
+            return;
+        }
+        tagCounter = cacheLatency;
+        fsmState = TAG;
+        waitForCacheLatency.write(0);
+    }
+
+    // Beyond the tag latency the cycle count continues from the overflow marker, as in update()
+    if (requestsExceeded) {
+        cycle = SIZE_MAX - 1;
+    }
+
+    if (fsmState == TAG) {
+        size_t currentMisses = resultTemp.misses;
+        unsigned size = requestSize.read();
+        fsmDataRead = access(requestAddr, requestData, size, requestWE, cycle, requestFetch, requestStream);
+        bool miss = resultTemp.misses > currentMisses;
+        unsigned penalty = memory_penalty(translatedAddress, miss, memoryLatency, requestWE ? (size ? size : 4) : 0, cycle);
+        resultHits.write(resultTemp.hits);
+        resultMisses.write(resultTemp.misses);
+
+        // Non-blocking: the fill is handed over to an MSHR, the request only waits if all MSHRs are busy
+        // or its line is still on its way
+        if (mshrs && !fetchAccess && !bufferedStore) {
+            penalty = mshr_stall(translatedAddress, miss, penalty, cycle);
+        }
+        penalty += translationCycles;
+
+        // Cache miss, or a hit on a prefetched line that is still on its way
+        fsmMiss = miss;
+        fsmState = RESPOND;
+        if (miss || penalty > 0) {
+            memoryCounter = penalty;
+            fsmState = MEM_WAIT;
+        }
+    }
+
+    if (fsmState == MEM_WAIT) {
+        if (memoryCounter > 0) {
+            memoryCounter--;
+            resultCycles.write(cycle + 1);
+            waitForMemoryLatency.write(1);
+            return;
+        }
+        waitForMemoryLatency.write(0);
+        fsmState = RESPOND;
+    }
+
+    // RESPOND: data-to-read is only ready after cacheLatency (+ memoryLatency)
+    if (!requestWE) {
+        data.write(fsmDataRead);
+    }
+    resultCycles.write(cycle + 1);
+    resultTemp.cycles = cycle + 1;
+    if (!requestsExceeded) {
+        record_latency(requestWE, fsmMiss, cycle + 1 - fsmStartCycle);
+    }
+    fsmState = IDLE;
+}
+
+bool CACHE_MODULE::enqueue(size_t index, const Request &request) {
+    QueuedRequest queuedRequest = {index, request, resultCycles.read()};
+    if (!requestQueue.nb_write(queuedRequest)) {
+        statistics->queueFullStalls++;
+        return false;
+    }
+    return true;
+}
+
+bool CACHE_MODULE::idle() {
+    return requestQueue.num_available() == 0 && resultCycles.read() >= lastCompleteCycle;
+}
+
+void CACHE_MODULE::update_queued() {
+    // Update primitiveGateCount based on calculated totalGates in constructor
+    wait(SC_ZERO_TIME);
+    resultPrimitiveGateCount.write(totalGates);
+    wait(SC_ZERO_TIME);
+    resultTemp.primitiveGateCount = resultPrimitiveGateCount.read();
+
+    size_t maxCompleteCycleInOrder = 0;
+
+    for (int i = 0; i < cycles; i++) {
+        size_t currentCycle = resultCycles.read();
+        if (mshrs) {
+            mshrs->tick(currentCycle);
+        }
+        if (storeBuffer) {
+            storeBuffer->tick(currentCycle);
+        }
+
+        // Every port starts one access per cycle unless a blocking miss or full MSHRs hold the cache
+        for (unsigned port = 0; port < cachePorts && currentCycle >= portsBlockedUntil; port++) {
+            QueuedRequest queuedRequest;
+            if (!requestQueue.nb_read(queuedRequest)) {
+                break;
+            }
+
+            uint32_t address = queuedRequest.request.addr;
+            size_t currentMisses = resultTemp.misses;
+            uint32_t dataRead = access(address, queuedRequest.request.data, queuedRequest.request.size, queuedRequest.request.we,
+                                       currentCycle, queuedRequest.request.fetch, queuedRequest.request.stream);
+            bool miss = resultTemp.misses > currentMisses;
+            unsigned writeBytes = queuedRequest.request.we ? (queuedRequest.request.size ? queuedRequest.request.size : 4) : 0;
+            unsigned penalty = memory_penalty(translatedAddress, miss, memoryLatency, writeBytes, currentCycle);
+
+            // Same latency as the blocking model: the tag latency, the translation, the access cycle and the memory penalty
+            size_t completeCycle = currentCycle + tag_latency(queuedRequest.request.fetch, queuedRequest.request.we) +
+                                   translationCycles + 1;
+            uint32_t lineAddress = (translatedAddress >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+            size_t readyCycle = 0;
+            if (mshrs && !fetchAccess && !bufferedStore && mshrs->merge(lineAddress, currentCycle, &readyCycle)) {
+                // The line is still being filled, the access completes once it arrives
+                completeCycle = max(completeCycle, readyCycle + cacheLatency + 1);
+            } else if (mshrs && !fetchAccess && !bufferedStore) {
+                if (miss || penalty > 0) {
+                    unsigned stall = mshrs->allocate(lineAddress, currentCycle, penalty);
+                    portsBlockedUntil = currentCycle + stall;
+                    completeCycle += stall + penalty;
+                }
+            } else if (miss || penalty > 0) {
+                completeCycle += penalty;
+                portsBlockedUntil = completeCycle;
+            }
+
+            RequestTiming &timing = requestTimings[queuedRequest.index];
+            timing.issueCycle = queuedRequest.issueCycle;
+            timing.startCycle = currentCycle;
+            timing.completeCycle = completeCycle;
+            timing.data = dataRead;
+
+            // A request that finishes before an older one completes out of order
+            if (completeCycle < maxCompleteCycleInOrder) {
+                statistics->outOfOrderCompletions++;
+            }
+            maxCompleteCycleInOrder = max(maxCompleteCycleInOrder, completeCycle);
+
+            record_latency(queuedRequest.request.we, miss, completeCycle - queuedRequest.issueCycle);
+            statistics->totalRequestLatency += completeCycle - queuedRequest.issueCycle;
+            statistics->maxRequestLatency = max(statistics->maxRequestLatency, completeCycle - queuedRequest.issueCycle);
+            lastCompleteCycle = max(lastCompleteCycle, completeCycle);
+            processedRequests++;
+        }
+
+        resultHits.write(resultTemp.hits);
+        resultMisses.write(resultTemp.misses);
+
+        resultTemp.cycles = lastCompleteCycle;
+        resultCycles.write(currentCycle + 1);
+        wait(SC_ZERO_TIME);
+        wait();
+    }
+}
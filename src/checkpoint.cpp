@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../includes/checkpoint.hpp"
+
+using namespace std;
+
+void CheckpointWriter::put_bytes(const uint8_t* data, size_t size) {
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+bool CheckpointWriter::write_to_file(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    return fclose(file) == 0 && written;
+}
+
+CheckpointReader::CheckpointReader(const char* path) : mapping(nullptr), size(0), position(0), overrun(false) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) == 0 && fileInfo.st_size > 0) {
+        void* address = mmap(nullptr, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            mapping = static_cast<const uint8_t*>(address);
+            size = fileInfo.st_size;
+        }
+    }
+
+    // The mapping stays valid after closing the file descriptor
+    close(fd);
+}
+
+CheckpointReader::~CheckpointReader() {
+    if (mapping) {
+        munmap(const_cast<uint8_t*>(mapping), size);
+    }
+}
+
+const uint8_t* CheckpointReader::get_bytes(size_t bytes) {
+    if (!mapping || overrun || bytes > size - position) {
+        overrun = true;
+        return nullptr;
+    }
+    const uint8_t* data = mapping + position;
+    position += bytes;
+    return data;
+}
@@ -0,0 +1,511 @@
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <deque>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "../includes/daemon.hpp"
+#include "../includes/cache_module.hpp"
+
+using namespace std;
+
+#define MAX_REQUEST_LINE 4096
+
+// One simulation request of a client, the id is a JSON value echoed verbatim in the response
+struct DaemonJob {
+    int clientFd;
+    uint64_t clientId; // the fd may be reused by a later connection
+    string id;
+    size_t traceIndex;
+    int cycles;
+    bool directMapped;
+    bool fullyAssociative;
+    unsigned cacheLines;
+    unsigned cacheLineSize;
+    unsigned cacheLatency;
+    unsigned memoryLatency;
+};
+
+struct DaemonClient {
+    uint64_t id;
+    string input; // unfinished request line
+};
+
+struct RunningJob {
+    DaemonJob job;
+    pid_t pid;
+    int resultFd;
+    string output;
+};
+
+// Flat JSON object with string, number and boolean values, values are kept as their raw text
+static bool parse_json_object(const string &line, map<string, string> &fields) {
+    size_t position = line.find('{');
+    if (position == string::npos) {
+        return false;
+    }
+    position++;
+
+    while (true) {
+        position = line.find_first_not_of(" \t\r", position);
+        if (position == string::npos) {
+            return false;
+        }
+        if (line[position] == '}') {
+            return true;
+        }
+        if (line[position] == ',') {
+            position++;
+            continue;
+        }
+        if (line[position] != '"') {
+            return false;
+        }
+        size_t keyEnd = line.find('"', position + 1);
+        if (keyEnd == string::npos) {
+            return false;
+        }
+        string key = line.substr(position + 1, keyEnd - position - 1);
+
+        size_t colon = line.find(':', keyEnd);
+        if (colon == string::npos) {
+            return false;
+        }
+        size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+        if (valueStart == string::npos) {
+            return false;
+        }
+
+        size_t valueEnd;
+        if (line[valueStart] == '"') {
+            valueEnd = valueStart + 1;
+            while (valueEnd < line.size() && line[valueEnd] != '"') {
+                valueEnd += (line[valueEnd] == '\\') ? 2 : 1;
+            }
+            if (valueEnd >= line.size()) {
+                return false;
+            }
+            valueEnd++;
+        } else {
+            valueEnd = line.find_first_of(",} \t\r", valueStart);
+            if (valueEnd == string::npos) {
+                return false;
+            }
+        }
+        fields[key] = line.substr(valueStart, valueEnd - valueStart);
+        position = valueEnd;
+    }
+}
+
+// Decodes a quoted JSON string value, returns false if it isn't one or has an invalid escape
+static bool json_string(const string &value, string &text) {
+    if (value.size() < 2 || value.front() != '"' || value.back() != '"') {
+        return false;
+    }
+    text.clear();
+    for (size_t i = 1; i + 1 < value.size(); i++) {
+        unsigned char c = value[i];
+        if (c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            text += c;
+            continue;
+        }
+        if (++i + 1 >= value.size()) {
+            return false;
+        }
+        switch (value[i]) {
+            case '"': text += '"'; break;
+            case '\\': text += '\\'; break;
+            case '/': text += '/'; break;
+            case 'b': text += '\b'; break;
+            case 'f': text += '\f'; break;
+            case 'n': text += '\n'; break;
+            case 'r': text += '\r'; break;
+            case 't': text += '\t'; break;
+            case 'u': {
+                // Code points of the basic multilingual plane, encoded as UTF-8
+                char* end;
+                string digits = value.substr(i + 1, 4);
+                unsigned long codePoint = strtoul(digits.c_str(), &end, 16);
+                if (digits.size() != 4 || *end != '\0' || digits.find_first_of("+- ") != string::npos ||
+                    (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+                    return false;
+                }
+                if (codePoint < 0x80) {
+                    text += static_cast<char>(codePoint);
+                } else if (codePoint < 0x800) {
+                    text += static_cast<char>(0xC0 | (codePoint >> 6));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3F));
+                } else {
+                    text += static_cast<char>(0xE0 | (codePoint >> 12));
+                    text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    text += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                i += 4;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Text as the contents of a JSON string
+static string json_escape(const string &text) {
+    string escaped;
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Number of digits at position
+static size_t json_digits(const string &value, size_t position) {
+    size_t count = 0;
+    while (position + count < value.size() && isdigit(static_cast<unsigned char>(value[position + count]))) {
+        count++;
+    }
+    return count;
+}
+
+// The id is echoed into the response, so it has to be null, a JSON number or a valid string
+static bool valid_id(const string &id) {
+    string text;
+    if (id == "null" || json_string(id, text)) {
+        return true;
+    }
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    size_t position = (!id.empty() && id[0] == '-') ? 1 : 0;
+    size_t digits = json_digits(id, position);
+    if (digits == 0 || (digits > 1 && id[position] == '0')) {
+        return false;
+    }
+    position += digits;
+    if (position < id.size() && id[position] == '.') {
+        digits = json_digits(id, position + 1);
+        if (digits == 0) {
+            return false;
+        }
+        position += 1 + digits;
+    }
+    if (position < id.size() && (id[position] == 'e' || id[position] == 'E')) {
+        position++;
+        if (position < id.size() && (id[position] == '+' || id[position] == '-')) {
+            position++;
+        }
+        digits = json_digits(id, position);
+        if (digits == 0) {
+            return false;
+        }
+        position += digits;
+    }
+    return position == id.size();
+}
+
+// Positive integer field up to maximum, or 0 if it is missing, malformed or out of range
+static unsigned long number_field(const map<string, string> &fields, const char* key, unsigned long maximum) {
+    auto it = fields.find(key);
+    if (it == fields.end() || it->second.empty() || !isdigit(static_cast<unsigned char>(it->second[0]))) {
+        return 0;
+    }
+    char* end;
+    errno = 0;
+    unsigned long value = strtoul(it->second.c_str(), &end, 10);
+    return (*end == '\0' && errno != ERANGE && value <= maximum) ? value : 0;
+}
+
+static void send_line(int fd, const string &line) {
+    size_t sent = 0;
+    while (sent < line.size()) {
+        ssize_t written = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return;
+        }
+        sent += written;
+    }
+}
+
+static string error_line(const string &id, const string &message) {
+    return "{\"id\": " + (id.empty() ? string("null") : id) + ", \"error\": \"" + json_escape(message) + "\"}\n";
+}
+
+// True while the connection that sent the job is still open
+static bool client_connected(const map<int, DaemonClient> &clients, const DaemonJob &job) {
+    auto it = clients.find(job.clientFd);
+    return it != clients.end() && it->second.id == job.clientId;
+}
+
+// Parses a request line into a job, on failure the error is the response line
+static bool parse_job(const string &line, const DaemonTrace traces[], size_t numTraces, DaemonJob &job, string &error) {
+    map<string, string> fields;
+    if (!parse_json_object(line, fields)) {
+        error = error_line("", "malformed JSON object");
+        return false;
+    }
+    job.id = fields.count("id") ? fields["id"] : "";
+    if (!job.id.empty() && !valid_id(job.id)) {
+        error = error_line("", "id should be a number, a string or null");
+        return false;
+    }
+
+    string traceName;
+    if (fields.count("trace")) {
+        json_string(fields["trace"], traceName);
+    }
+    job.traceIndex = numTraces;
+    for (size_t i = 0; i < numTraces; i++) {
+        if (traceName == traces[i].name) {
+            job.traceIndex = i;
+        }
+    }
+    if (job.traceIndex == numTraces) {
+        error = error_line(job.id, "unknown trace");
+        return false;
+    }
+
+    // The command line spelling fully-associative is accepted as well
+    string organization;
+    if (fields.count("organization")) {
+        json_string(fields["organization"], organization);
+    }
+    bool fourway = organization == "fourway";
+    job.directMapped = organization == "directmapped";
+    job.fullyAssociative = organization == "fully_associative" || organization == "fully-associative";
+    job.cycles = static_cast<int>(number_field(fields, "cycles", INT_MAX));
+    job.cacheLines = number_field(fields, "cachelines", UINT_MAX);
+    job.cacheLineSize = number_field(fields, "cacheline_size", UINT_MAX);
+    job.cacheLatency = number_field(fields, "cache_latency", UINT_MAX);
+    job.memoryLatency = number_field(fields, "memory_latency", UINT_MAX);
+
+    // Same constraints as the command line options
+    if (!job.directMapped && !fourway && !job.fullyAssociative) {
+        error = error_line(job.id, "organization should be directmapped, fourway or fully-associative");
+    } else if (job.cycles <= 0 || job.cacheLines == 0 || job.cacheLineSize == 0 || job.cacheLatency == 0 || job.memoryLatency == 0) {
+        error = error_line(job.id, "cycles, cachelines, cacheline_size, cache_latency and memory_latency should be positive integers in range");
+    } else if (job.cacheLineSize % 4 != 0) {
+        error = error_line(job.id, "cacheline_size should be a multiple of 4");
+    } else if (fourway && (job.cacheLines < 4 || job.cacheLines % 4 != 0)) {
+        error = error_line(job.id, "for a 4-way associative cache, cachelines should be a multiple of 4");
+    } else if (job.directMapped && (job.cacheLines & (job.cacheLines - 1)) != 0) {
+        error = error_line(job.id, "for a direct-mapped cache, cachelines should be a power of two");
+    }
+    return error.empty();
+}
+
+// Runs the job in a forked worker, which gets a fresh SystemC kernel and main memory of its own while
+// the traces are shared copy-on-write. The worker writes its response line into the returned pipe.
+static bool start_job(const DaemonJob &job, const DaemonTrace traces[], RunningJob &running) {
+    int resultPipe[2];
+    if (pipe(resultPipe) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(resultPipe[0]);
+        close(resultPipe[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(resultPipe[0]);
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        SimulationOptions options = {};
+        options.fullyAssociative = job.fullyAssociative;
+        SimulationStatistics* statistics = new SimulationStatistics();
+        const DaemonTrace &trace = traces[job.traceIndex];
+        Result result = run_simulation_with_options(job.cycles, job.directMapped, job.cacheLines, job.cacheLineSize,
+                                                    job.cacheLatency, job.memoryLatency, trace.numRequests,
+                                                    trace.requests, "", &options, statistics);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        // The id can be as long as a request line, so the response isn't built in a fixed buffer
+        char wallTime[32];
+        snprintf(wallTime, sizeof(wallTime), "%.3f", (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) * 1e-6);
+        string line = "{\"id\": " + (job.id.empty() ? string("null") : job.id) + ", \"trace\": \"" + json_escape(trace.name) +
+                      "\", \"cycles\": " + to_string(result.cycles) + ", \"misses\": " + to_string(result.misses) +
+                      ", \"hits\": " + to_string(result.hits) + ", \"primitive_gate_count\": " +
+                      to_string(result.primitiveGateCount) + ", \"wall_ms\": " + wallTime + "}\n";
+        size_t written = 0;
+        while (written < line.size()) {
+            ssize_t count = write(resultPipe[1], line.data() + written, line.size() - written);
+            if (count <= 0) {
+                _exit(EXIT_FAILURE);
+            }
+            written += count;
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(resultPipe[1]);
+    running.job = job;
+    running.pid = pid;
+    running.resultFd = resultPipe[0];
+    running.output.clear();
+    return true;
+}
+
+int run_daemon(const char* socketPath, const DaemonTrace traces[], size_t numTraces, unsigned workers) {
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (listenFd < 0 || strlen(socketPath) >= sizeof(address.sun_path)) {
+        cerr << "Error: Can't create the socket " << socketPath << endl;
+        return EXIT_FAILURE;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    // A socket file left behind by a previous daemon is replaced
+    unlink(socketPath);
+    if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 16) != 0) {
+        cerr << "Error: Can't listen on " << socketPath << endl;
+        close(listenFd);
+        return EXIT_FAILURE;
+    }
+    cerr << "Listening on " << socketPath << " with " << numTraces << " traces and " << workers << " workers" << endl;
+
+    map<int, DaemonClient> clients;
+    uint64_t nextClientId = 0;
+    deque<DaemonJob> pendingJobs;
+    vector<RunningJob> runningJobs;
+
+    while (true) {
+        // Start queued jobs while workers are free, jobs of disconnected clients are dropped
+        while (runningJobs.size() < workers && !pendingJobs.empty()) {
+            DaemonJob job = pendingJobs.front();
+            pendingJobs.pop_front();
+            RunningJob running;
+            if (!client_connected(clients, job)) {
+                continue;
+            }
+            if (!start_job(job, traces, running)) {
+                send_line(job.clientFd, error_line(job.id, "can't start a worker"));
+                continue;
+            }
+            runningJobs.push_back(running);
+        }
+
+        // The slots are fixed until the next poll, clients and jobs only change in between
+        vector<struct pollfd> pollFds;
+        pollFds.push_back({listenFd, POLLIN, 0});
+        for (auto &client : clients) {
+            pollFds.push_back({client.first, POLLIN, 0});
+        }
+        size_t numClientSlots = clients.size();
+        for (auto &running : runningJobs) {
+            pollFds.push_back({running.resultFd, POLLIN, 0});
+        }
+        size_t numRunningSlots = runningJobs.size();
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0) {
+            continue;
+        }
+
+        // Requests are split at newlines, every complete line becomes a job
+        for (size_t slot = 1; slot <= numClientSlots; slot++) {
+            if (!(pollFds[slot].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            int clientFd = pollFds[slot].fd;
+            char buffer[MAX_REQUEST_LINE];
+            ssize_t received = recv(clientFd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                close(clientFd);
+                clients.erase(clientFd);
+                continue;
+            }
+
+            string &input = clients[clientFd].input;
+            input.append(buffer, received);
+            size_t newline;
+            while ((newline = input.find('\n')) != string::npos) {
+                string line = input.substr(0, newline);
+                input.erase(0, newline + 1);
+                if (line.find_first_not_of(" \t\r") == string::npos) {
+                    continue;
+                }
+                DaemonJob job;
+                string error;
+                if (parse_job(line, traces, numTraces, job, error)) {
+                    job.clientFd = clientFd;
+                    job.clientId = clients[clientFd].id;
+                    pendingJobs.push_back(job);
+                } else {
+                    send_line(clientFd, error);
+                }
+            }
+            if (input.size() > MAX_REQUEST_LINE) {
+                send_line(clientFd, error_line("", "request line too long"));
+                input.clear();
+            }
+        }
+
+        // Results are streamed back as the workers finish, in completion order
+        size_t i = 0;
+        for (size_t slot = 1 + numClientSlots; slot <= numClientSlots + numRunningSlots; slot++) {
+            RunningJob &running = runningJobs[i];
+            if (!(pollFds[slot].revents & (POLLIN | POLLHUP | POLLERR))) {
+                i++;
+                continue;
+            }
+            char buffer[512];
+            ssize_t received = read(running.resultFd, buffer, sizeof(buffer));
+            if (received > 0) {
+                running.output.append(buffer, received);
+                i++;
+                continue;
+            }
+
+            close(running.resultFd);
+            int status;
+            waitpid(running.pid, &status, 0);
+            if (client_connected(clients, running.job)) {
+                bool succeeded = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && !running.output.empty();
+                send_line(running.job.clientFd, succeeded ? running.output : error_line(running.job.id, "simulation failed"));
+            }
+            runningJobs.erase(runningJobs.begin() + i);
+        }
+
+        // New connections only get a slot in the next poll
+        if (pollFds[0].revents & POLLIN) {
+            int clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd >= 0) {
+                clients[clientFd] = {nextClientId++, ""};
+            }
+        }
+    }
+}
@@ -1,42 +1,41 @@
 #include <iostream>
 #include <cmath>
+#include <cstring>
 
 #include "../includes/direct_mapped_cache.hpp"
 #include "../includes/main_memory_global.hpp"
 
 using namespace std;
 
-DirectMappedCache::DirectMappedCache(unsigned numOfCacheLines, CacheConfig cacheConfig) : numOfCacheLines(numOfCacheLines) {
-    cacheLine = new CacheLine[numOfCacheLines];
-
-    // Allocate data[] with a size depending on number of offset bits
+DirectMappedCache::DirectMappedCache(unsigned numOfCacheLines, CacheConfig cacheConfig, unsigned victimEntries,
+                                     SimulationStatistics* statistics, bool hugePages)
+    : arena(Arena::size_for(numOfCacheLines, sizeof(CacheLine)) +
+            Arena::size_for(numOfCacheLines, static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits))) +
+            Arena::size_for(victimEntries, static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits))), hugePages),
+      numOfCacheLines(numOfCacheLines), statistics(statistics) {
+    uint32_t lineSize = static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits));
+    cacheLine = arena.allocate_array<CacheLine>(numOfCacheLines);
+
+    // Carve data[] with a size depending on number of offset bits out of one block
+    uint8_t* lineStorage = static_cast<uint8_t*>(arena.allocate(numOfCacheLines * lineSize));
     for (unsigned i = 0; i < numOfCacheLines; i++) {
-        cacheLine[i].data = new uint8_t[static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits))]; 
+        cacheLine[i].data = &lineStorage[i * lineSize];
+    }
+
+    // Optional victim buffer probed on misses
+    victimBuffer = nullptr;
+    if (victimEntries > 0) {
+        victimBuffer = new VictimBuffer(victimEntries, lineSize, arena);
     }
 }
 
 DirectMappedCache::~DirectMappedCache() {
-    for (unsigned i = 0; i < numOfCacheLines; i++) {
-        delete[] cacheLine[i].data;
-    }
-    delete[] cacheLine;
+    delete victimBuffer;
 }
 
 uint32_t DirectMappedCache::read_from_cache(uint32_t address, CacheConfig cacheConfig, Result &result) {
     CacheAddress cacheAddress(address, cacheConfig);
-    CacheLine &currentCacheLine = cacheLine[cacheAddress.index];
-
-    // Replace when cold miss or when tag is different, and update number of misses/hits
-    bool found = true;
-    if (currentCacheLine.isFirstTime || currentCacheLine.tag != cacheAddress.tag) {
-        replace(address, currentCacheLine, cacheConfig.numberOfOffsetBits, cacheConfig);
-        currentCacheLine.isFirstTime = false;
-        result.misses++;
-        found = false;
-    }
-    if (found) {
-        result.hits++;
-    }
+    CacheLine &currentCacheLine = lookup(address, 4, cacheAddress, cacheConfig, result);
 
     // Merge 4 bytes of data from 4 consecutive offsets into a single 32-bit-unsigned integer
     uint8_t data1 = currentCacheLine.data[cacheAddress.offset];
@@ -50,19 +49,7 @@ uint32_t DirectMappedCache::read_from_cache(uint32_t address, CacheConfig cacheC
 
 void DirectMappedCache::write_to_cache(uint32_t address, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) {
     CacheAddress cacheAddress(address, cacheConfig);
-    CacheLine &currentCacheLine = cacheLine[cacheAddress.index];
-
-    // Replace when cold miss or when tag is different, and update number of misses/hits
-    bool found = true;
-    if (currentCacheLine.isFirstTime || currentCacheLine.tag != cacheAddress.tag) {
-        replace(address, currentCacheLine, cacheConfig.numberOfOffsetBits, cacheConfig);
-        currentCacheLine.isFirstTime = false;
-        result.misses++;
-        found = false;
-    }
-    if (found) {
-        result.hits++;
-    }
+    CacheLine &currentCacheLine = lookup(address, 4, cacheAddress, cacheConfig, result);
 
     // Split a 32-bit-unsigned integer into 4 bytes of data with consecutive offsets according to little-endian
     uint8_t byteOfData = static_cast<uint8_t>(dataToWrite & 0xFF);
@@ -82,18 +69,139 @@ void DirectMappedCache::write_to_cache(uint32_t address, CacheConfig cacheConfig
     mainMemory->write_to_ram(address + 3, byteOfData);
 }
 
-void DirectMappedCache::replace(uint32_t address, CacheLine &currentCacheLine, uint32_t numberOfOffset, CacheConfig cacheConfig) {
-    uint32_t totalOffset = static_cast<uint32_t>(pow(2, numberOfOffset));
+bool DirectMappedCache::prefetch(uint32_t address, CacheConfig cacheConfig) {
+    repeatLine.forget();
+    CacheAddress cacheAddress(address, cacheConfig);
+    CacheLine &currentCacheLine = cacheLine[cacheAddress.index];
 
-    // Fetch a block of data from the main memory
-    uint32_t startAddressToFetch = (address / totalOffset) * totalOffset;
-    uint32_t lastAddressToFetch = startAddressToFetch + totalOffset - 1;
+    if (!currentCacheLine.isFirstTime && currentCacheLine.tag == cacheAddress.tag) {
+        return false;
+    }
+
+    // A line already held by the victim buffer is swapped back without a fill
+    if (evict_to_victim_buffer(address, cacheAddress, currentCacheLine, cacheConfig)) {
+        return false;
+    }
 
-    for (uint32_t ramAddress = startAddressToFetch, offset = 0; ramAddress <= lastAddressToFetch; ramAddress++, offset++) {
-        currentCacheLine.data[offset] = mainMemory->read_from_ram(ramAddress);
+    replace(address, currentCacheLine, cacheConfig.numberOfOffsetBits, cacheConfig, all_sectors(cacheConfig));
+    currentCacheLine.isFirstTime = false;
+    currentCacheLine.isPrefetched = true;
+    return true;
+}
+
+bool DirectMappedCache::evict_to_victim_buffer(uint32_t address, CacheAddress cacheAddress, CacheLine &currentCacheLine, CacheConfig cacheConfig) {
+    if (!victimBuffer) {
+        return false;
     }
 
+    uint32_t lineNumber = address >> cacheConfig.numberOfOffsetBits;
+    uint32_t evictedLineNumber = (currentCacheLine.tag << cacheConfig.numberOfIndexBits) | cacheAddress.index;
+    bool evictedValid = !currentCacheLine.isFirstTime;
+
+    // Swap with the victim buffer if it holds the line, otherwise keep the evicted line there
+    if (victimBuffer->swap(lineNumber, currentCacheLine.data, currentCacheLine.validSectors, evictedValid, evictedLineNumber)) {
+        currentCacheLine.tag = cacheAddress.tag;
+        currentCacheLine.isFirstTime = false;
+        currentCacheLine.isPrefetched = false;
+        return true;
+    }
+    if (evictedValid) {
+        victimBuffer->insert(evictedLineNumber, currentCacheLine.data, currentCacheLine.validSectors);
+    }
+    return false;
+}
+
+uint8_t* DirectMappedCache::access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) {
+    CacheAddress cacheAddress(address, cacheConfig);
+    return lookup(address, size, cacheAddress, cacheConfig, result).data;
+}
+
+CacheLine& DirectMappedCache::lookup(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result) {
+    CacheLine &currentCacheLine = cacheLine[cacheAddress.index];
+    uint64_t sectorMask = sector_mask(cacheAddress.offset, size, cacheConfig);
+
+    // Replace when cold miss or when tag is different, and update number of misses/hits
+    lastAccess = AccessInfo();
+    if (currentCacheLine.isFirstTime || currentCacheLine.tag != cacheAddress.tag) {
+        // A line swapped in from the victim buffer counts as a hit
+        if (evict_to_victim_buffer(address, cacheAddress, currentCacheLine, cacheConfig)) {
+            lastAccess.victimHit = true;
+            result.hits++;
+        } else {
+            lastAccess.sectorsFetched = replace(address, currentCacheLine, cacheConfig.numberOfOffsetBits, cacheConfig, sectorMask);
+            currentCacheLine.isFirstTime = false;
+            currentCacheLine.isPrefetched = false;
+            result.misses++;
+            repeatLine.remember(address, currentCacheLine.data, currentCacheLine.validSectors, cacheConfig);
+            return currentCacheLine;
+        }
+    } else {
+        lastAccess.prefetchedHit = currentCacheLine.isPrefetched;
+        currentCacheLine.isPrefetched = false;
+        result.hits++;
+    }
+
+    // Sectored line: the tag matches but an accessed sector has not been fetched yet
+    if ((currentCacheLine.validSectors & sectorMask) != sectorMask) {
+        uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+        lastAccess.sectorsFetched = fetch_sectors(currentCacheLine.data, lineAddress, sectorMask & ~currentCacheLine.validSectors, cacheConfig);
+        lastAccess.sectorMiss = true;
+        lastAccess.victimHit = false;
+        currentCacheLine.validSectors |= sectorMask;
+        result.hits--;
+        result.misses++;
+    }
+    if (lastAccess.victimHit) {
+        statistics->victimHits++;
+    }
+    repeatLine.remember(address, currentCacheLine.data, currentCacheLine.validSectors, cacheConfig);
+    return currentCacheLine;
+}
+
+unsigned DirectMappedCache::replace(uint32_t address, CacheLine &currentCacheLine, uint32_t numberOfOffset, CacheConfig cacheConfig, uint64_t sectorsToFetch) {
+    uint32_t totalOffset = static_cast<uint32_t>(pow(2, numberOfOffset));
+
+    // Fetch a block of data from the main memory, only the requested sectors if the line is sectored
+    uint32_t startAddressToFetch = (address / totalOffset) * totalOffset;
+    unsigned sectorsFetched = fetch_sectors(currentCacheLine.data, startAddressToFetch, sectorsToFetch, cacheConfig);
+    currentCacheLine.validSectors = sectorsToFetch;
+
     // Update tag
     CacheAddress newAddress(startAddressToFetch, cacheConfig);
     currentCacheLine.tag = newAddress.tag;
+    return sectorsFetched;
+}
+
+void DirectMappedCache::save_state(CheckpointWriter &writer, CacheConfig cacheConfig) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+    for (unsigned i = 0; i < numOfCacheLines; i++) {
+        writer.put(cacheLine[i].tag);
+        writer.put(static_cast<uint8_t>(cacheLine[i].isFirstTime));
+        writer.put(static_cast<uint8_t>(cacheLine[i].isPrefetched));
+        writer.put(cacheLine[i].validSectors);
+        writer.put_bytes(cacheLine[i].data, lineSize);
+    }
+    if (victimBuffer) {
+        victimBuffer->save_state(writer);
+    }
+}
+
+bool DirectMappedCache::load_state(CheckpointReader &reader, CacheConfig cacheConfig) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+    repeatLine.forget();
+    for (unsigned i = 0; i < numOfCacheLines; i++) {
+        cacheLine[i].tag = reader.get<uint32_t>();
+        cacheLine[i].isFirstTime = reader.get<uint8_t>() != 0;
+        cacheLine[i].isPrefetched = reader.get<uint8_t>() != 0;
+        cacheLine[i].validSectors = reader.get<uint64_t>();
+        const uint8_t* lineData = reader.get_bytes(lineSize);
+        if (!lineData) {
+            return false;
+        }
+        memcpy(cacheLine[i].data, lineData, lineSize);
+    }
+    if (victimBuffer && !victimBuffer->load_state(reader)) {
+        return false;
+    }
+    return reader.ok();
 }
@@ -0,0 +1,56 @@
+#include <algorithm>
+
+#include "../includes/dram.hpp"
+
+using namespace std;
+
+DramController::DramController(const SimulationOptions* options, SimulationStatistics* statistics) : statistics(statistics) {
+    channels = options->dramChannels > 0 ? options->dramChannels : 1;
+    banksPerChannel = options->dramBanks > 0 ? options->dramBanks : 8;
+    rowSize = options->dramRowSize > 0 ? options->dramRowSize : 1024;
+    tRCD = options->dramTRCD;
+    tCAS = options->dramTCAS;
+    tRP = options->dramTRP;
+    closedPage = options->dramClosedPage;
+    banks.resize(channels * banksPerChannel);
+}
+
+unsigned DramController::access(uint32_t address, size_t cycle) {
+    uint32_t rowNumber = address / rowSize;
+    unsigned channel = rowNumber % channels;
+    unsigned bankIndex = (rowNumber / channels) % banksPerChannel;
+    int64_t row = rowNumber / channels / banksPerChannel;
+    Bank &bank = banks[channel * banksPerChannel + bankIndex];
+
+    size_t start;
+    size_t dataReadyCycle;
+    if (bank.openRow == row) {
+        // Row hit: only the column access
+        start = max(cycle, bank.columnReadyCycle);
+        dataReadyCycle = start + tCAS;
+        statistics->dramRowHits++;
+    } else {
+        // Row miss: wait for the bank, precharge the open row if there is one, then activate
+        start = max(cycle, bank.bankReadyCycle);
+        if (bank.openRow >= 0) {
+            start += tRP;
+            statistics->dramRowConflicts++;
+        } else {
+            statistics->dramRowEmpty++;
+        }
+        dataReadyCycle = start + tRCD + tCAS;
+        bank.openRow = row;
+    }
+    statistics->dramQueueCycles += start - cycle;
+
+    // Column accesses to the same row are pipelined, the bank can't be precharged before the data is out
+    bank.columnReadyCycle = dataReadyCycle - tCAS + 1;
+    bank.bankReadyCycle = max(bank.bankReadyCycle, dataReadyCycle);
+
+    // Closed-page policy: precharge right after the access, the next access only activates
+    if (closedPage) {
+        bank.openRow = -1;
+        bank.bankReadyCycle = dataReadyCycle + tRP;
+    }
+    return static_cast<unsigned>(dataReadyCycle - cycle);
+}
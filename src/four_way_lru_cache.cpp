@@ -1,19 +1,19 @@
 #include <iostream>
 #include <unordered_map>
 #include <cmath>
+#include <cstring>
 
 #include "../includes/four_way_lru_cache.hpp"
 #include "../includes/main_memory_global.hpp"
 
 using namespace std;
 
-LRUCache::Node::Node(uint32_t numberOfOffsetBits) : next(nullptr), prev(nullptr) {
-    data = new uint8_t[static_cast<uint32_t>(pow(2, numberOfOffsetBits))];
+LRUCache::Node::Node() : data(nullptr), next(nullptr), prev(nullptr) {
+    tagAsMapKey = 0;
     isFirstTime = true;
-}
-
-LRUCache::Node::~Node() {
-    delete[] data;
+    isPrefetched = false;
+    validSectors = 0;
+    owner = 0;
 }
 
 void LRUCache::update_to_mru(Node* node) {
@@ -35,49 +35,94 @@ void LRUCache::remove_node(Node* node) {
     next->prev = prev;
 }
 
-LRUCache::LRUCache(CacheConfig cacheConfig) {
+LRUCache::LRUCache(CacheConfig cacheConfig, AccessInfo* lastAccess, WayPartition* partition, RepeatLine* repeatLine, Arena &arena)
+    : lastAccess(lastAccess), partition(partition), repeatLine(repeatLine) {
+    // All nodes live for the lifetime of the cache, misses recycle them in place
+    uint32_t lineSize = static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits));
+    numberOfNodes = cacheConfig.numberOfTagBits;
+    nodes = arena.allocate_array<Node>(numberOfNodes + 2);
+    uint8_t* lineStorage = static_cast<uint8_t*>(arena.allocate(numberOfNodes * lineSize));
+    map.reserve(numberOfNodes);
+
     // Create dummy head and tail
-    head = new Node(cacheConfig.numberOfOffsetBits);
-    tail = new Node(cacheConfig.numberOfOffsetBits);
+    head = &nodes[numberOfNodes];
+    tail = &nodes[numberOfNodes + 1];
     head->next = tail;
     tail->prev = head;
 
     // Add 4 nodes in between head and tail
-    for (int i = 0; i < cacheConfig.numberOfTagBits; i++) {
-        Node* node = new Node(cacheConfig.numberOfOffsetBits);
+    for (uint32_t i = 0; i < numberOfNodes; i++) {
+        Node* node = &nodes[i];
+        node->data = &lineStorage[i * lineSize];
         node->tagAsMapKey = i; 
         add_node(node);
         map[i] = node;
     }
 }
 
-LRUCache::~LRUCache() {
-    Node* current = head;
-    while (current != nullptr) {
-        Node* next = current->next;
-        delete current;
-        current = next;
-    }
+size_t LRUCache::arena_size(CacheConfig cacheConfig) {
+    return Arena::size_for(cacheConfig.numberOfTagBits + 2, sizeof(Node)) +
+           Arena::size_for(cacheConfig.numberOfTagBits, static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits)));
 }
 
-uint32_t LRUCache::read_from_cache(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result) {
+LRUCache::Node* LRUCache::lookup(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result) {
+    uint64_t sectorMask = CacheBase::sector_mask(cacheAddress.offset, size, cacheConfig);
+
     // Replace if the tag isn't in the map or if it's a cold miss, and update number of misses/hits
+    *lastAccess = AccessInfo();
     bool found = true;
     if (map.find(cacheAddress.tag) == map.end()) {
-        replace_lru(address, cacheAddress.tag, cacheConfig);
+        lastAccess->sectorsFetched = replace_lru(address, cacheAddress.tag, cacheConfig, sectorMask);
         result.misses++;
         found = false;
     } else if (map[cacheAddress.tag]->isFirstTime) {
-        replace_lru(address, cacheAddress.tag, cacheConfig);
+        lastAccess->sectorsFetched = replace_lru(address, cacheAddress.tag, cacheConfig, sectorMask);
         result.misses++;
         found = false;
     }
-    if (found) {
+
+    Node* node = map[cacheAddress.tag];
+    if (!found) {
+        repeatLine->remember(address, node->data, node->validSectors, cacheConfig);
+        return node;
+    }
+
+    // Sectored line: the tag matches but an accessed sector has not been fetched yet
+    if ((node->validSectors & sectorMask) != sectorMask) {
+        uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+        lastAccess->sectorsFetched = CacheBase::fetch_sectors(node->data, lineAddress, sectorMask & ~node->validSectors, cacheConfig);
+        lastAccess->sectorMiss = true;
+        node->validSectors |= sectorMask;
+        result.misses++;
+    } else {
         result.hits++;
     }
 
+    lastAccess->prefetchedHit = node->isPrefetched && !lastAccess->sectorMiss;
+    node->isPrefetched = false;
+    repeatLine->remember(address, node->data, node->validSectors, cacheConfig);
+    return node;
+}
+
+bool LRUCache::prefetch(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig) {
+    repeatLine->forget();
+    auto it = map.find(cacheAddress.tag);
+    if (it != map.end() && !it->second->isFirstTime) {
+        return false;
+    }
+
+    // Insert the prefetched line as MRU so that it survives until its first use
+    replace_lru(address, cacheAddress.tag, cacheConfig, CacheBase::all_sectors(cacheConfig));
+    Node* node = map[cacheAddress.tag];
+    node->isPrefetched = true;
+    update_to_mru(node);
+    return true;
+}
+
+uint32_t LRUCache::read_from_cache(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result) {
+    Node* node = lookup(address, 4, cacheAddress, cacheConfig, result);
+
     // Merge 4 bytes of data from 4 consecutive offsets into a single 32-bit-unsigned integer
-    Node* node = map[cacheAddress.tag]; 
     uint8_t data1 = node->data[cacheAddress.offset];
     uint8_t data2 = node->data[cacheAddress.offset + 1];
     uint8_t data3 = node->data[cacheAddress.offset + 2];
@@ -90,23 +135,9 @@ uint32_t LRUCache::read_from_cache(uint32_t address, CacheAddress cacheAddress,
 }
 
 void LRUCache::write_to_cache(uint32_t address, CacheAddress cacheAddress, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) {
-    // Replace if the tag isn't in the map or if it's a cold miss, and update number of misses/hits
-    bool found = true;
-    if (map.find(cacheAddress.tag) == map.end()) {
-        replace_lru(address, cacheAddress.tag, cacheConfig);
-        result.misses++;
-        found = false;
-    } else if (map[cacheAddress.tag]->isFirstTime) {
-        replace_lru(address, cacheAddress.tag, cacheConfig);
-        result.misses++;
-        found = false;
-    }
-    if (found) {
-        result.hits++;
-    }
+    Node* node = lookup(address, 4, cacheAddress, cacheConfig, result);
 
     // Split a 32-bit-unsigned integer into 4 bytes of data with consecutive offsets according to little-endian
-    Node* node = map[cacheAddress.tag];
 
     uint8_t byteOfData = static_cast<uint8_t>(dataToWrite & 0xFF);
     node->data[cacheAddress.offset] = byteOfData;
@@ -127,37 +158,103 @@ void LRUCache::write_to_cache(uint32_t address, CacheAddress cacheAddress, Cache
     update_to_mru(node);
 }
 
-void LRUCache::replace_lru(uint32_t address, uint32_t cacheAddressTag, CacheConfig cacheConfig) {
-    // Update the LRU node with a new node with the correct attributes
-    Node* LRUNode = tail->prev;
-    Node* newNode = new Node(cacheConfig.numberOfOffsetBits);
+uint8_t* LRUCache::access_line(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result) {
+    Node* node = lookup(address, size, cacheAddress, cacheConfig, result);
+    update_to_mru(node);
+    return node->data;
+}
+
+unsigned LRUCache::replace_lru(uint32_t address, uint32_t cacheAddressTag, CacheConfig cacheConfig, uint64_t sectorsToFetch) {
+    // Reuse the LRU node in place with the correct attributes, it keeps its position and data buffer.
+    // A partitioned stream takes the least recently used of its ways, all ways if none of them exists.
+    Node* newNode = tail->prev;
+    uint32_t wayMask = partition->wayMasks[partition->stream];
+    for (Node* node = tail->prev; wayMask != 0 && node != head; node = node->prev) {
+        uint32_t way = static_cast<uint32_t>(node - nodes);
+        if (way < 32 && (wayMask >> way) & 1) {
+            newNode = node;
+            break;
+        }
+    }
+    map.erase(newNode->tagAsMapKey);
 
-    newNode->next = tail;
-    newNode->prev = LRUNode->prev;
-    LRUNode->prev->next = newNode;
-    tail->prev = newNode;
+    if (!newNode->isFirstTime) {
+        partition->linesOwned[newNode->owner]--;
+    }
+    newNode->owner = static_cast<uint8_t>(partition->stream);
+    partition->linesOwned[newNode->owner]++;
 
     newNode->tagAsMapKey = cacheAddressTag;
     newNode->isFirstTime = false;
-
-    map.erase(LRUNode->tagAsMapKey);
+    newNode->isPrefetched = false;
     map[cacheAddressTag] = newNode;
-    delete LRUNode;
 
-    // Fetch a block of data from the main memory
+    // Fetch a block of data from the main memory, only the requested sectors if the line is sectored
     uint32_t totalOffset = static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits));
     uint32_t startAddressToFetch = (address / totalOffset) * totalOffset;
-    uint32_t lastAddressToFetch = startAddressToFetch + totalOffset - 1;
-    
-    for (uint32_t RAMAddress = startAddressToFetch, offset = 0; RAMAddress <= lastAddressToFetch; RAMAddress++, offset++) { // O(1)
-        newNode->data[offset] = mainMemory->read_from_ram(RAMAddress);
+    newNode->validSectors = sectorsToFetch;
+    return CacheBase::fetch_sectors(newNode->data, startAddressToFetch, sectorsToFetch, cacheConfig);
+}
+
+void LRUCache::save_state(CheckpointWriter &writer, CacheConfig cacheConfig) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+    writer.put(numberOfNodes);
+    for (Node* node = head->next; node != tail; node = node->next) {
+        auto it = map.find(node->tagAsMapKey);
+        writer.put(node->tagAsMapKey);
+        writer.put(static_cast<uint8_t>(it != map.end() && it->second == node));
+        writer.put(static_cast<uint8_t>(node->isFirstTime));
+        writer.put(static_cast<uint8_t>(node->isPrefetched));
+        writer.put(node->validSectors);
+        writer.put_bytes(node->data, lineSize);
+    }
+}
+
+bool LRUCache::load_state(CheckpointReader &reader, CacheConfig cacheConfig) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+
+    if (reader.get<uint32_t>() != numberOfNodes) {
+        return false;
+    }
+
+    // Unlink the nodes, keeping the dummy head and tail
+    head->next = tail;
+    tail->prev = head;
+    map.clear();
+
+    // Rebuild the list from MRU to LRU by appending in front of the tail
+    for (uint32_t i = 0; i < numberOfNodes && reader.ok(); i++) {
+        Node* node = &nodes[i];
+        node->tagAsMapKey = reader.get<uint32_t>();
+        bool mapped = reader.get<uint8_t>() != 0;
+        node->isFirstTime = reader.get<uint8_t>() != 0;
+        node->isPrefetched = reader.get<uint8_t>() != 0;
+        node->validSectors = reader.get<uint64_t>();
+        node->owner = 0;
+        partition->linesOwned[0] += node->isFirstTime ? 0 : 1;
+
+        node->next = tail;
+        node->prev = tail->prev;
+        tail->prev->next = node;
+        tail->prev = node;
+        if (mapped) {
+            map[node->tagAsMapKey] = node;
+        }
+
+        const uint8_t* lineData = reader.get_bytes(lineSize);
+        if (!lineData) {
+            return false;
+        }
+        memcpy(node->data, lineData, lineSize);
     }
+    return reader.ok();
 }
 
-FourWayLRUCache::FourWayLRUCache(CacheConfig cacheConfig) {
+FourWayLRUCache::FourWayLRUCache(CacheConfig cacheConfig, bool hugePages)
+    : arena(LRUCache::arena_size(cacheConfig) * static_cast<uint32_t>(pow(2, cacheConfig.numberOfIndexBits)), hugePages) {
     // Instantiate number of LRU Caches based index bits
     for (uint32_t i = 0; i < static_cast<uint32_t>(pow(2, cacheConfig.numberOfIndexBits)); i++) {
-        cacheSets.push_back(new LRUCache(cacheConfig));
+        cacheSets.push_back(new LRUCache(cacheConfig, &lastAccess, &partition, &repeatLine, arena));
     }
 }
 
@@ -180,3 +277,32 @@ void FourWayLRUCache::write_to_cache(uint32_t address, CacheConfig cacheConfig,
     uint32_t setIndex = cacheAddress.index;
     cacheSets[setIndex]->write_to_cache(address, cacheAddress, cacheConfig, dataToWrite, result);
 }
+
+bool FourWayLRUCache::prefetch(uint32_t address, CacheConfig cacheConfig) {
+    CacheAddress cacheAddress(address, cacheConfig);
+    return cacheSets[cacheAddress.index]->prefetch(address, cacheAddress, cacheConfig);
+}
+
+uint8_t* FourWayLRUCache::access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) {
+    CacheAddress cacheAddress(address, cacheConfig);
+    return cacheSets[cacheAddress.index]->access_line(address, size, cacheAddress, cacheConfig, result);
+}
+
+void FourWayLRUCache::save_state(CheckpointWriter &writer, CacheConfig cacheConfig) {
+    for (auto cacheSet : cacheSets) {
+        cacheSet->save_state(writer, cacheConfig);
+    }
+}
+
+bool FourWayLRUCache::load_state(CheckpointReader &reader, CacheConfig cacheConfig) {
+    repeatLine.forget();
+    for (size_t &lines : partition.linesOwned) {
+        lines = 0;
+    }
+    for (auto cacheSet : cacheSets) {
+        if (!cacheSet->load_state(reader, cacheConfig)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,221 @@
+#include <cstring>
+
+#include "../includes/fully_associative_cache.hpp"
+#include "../includes/main_memory_global.hpp"
+
+using namespace std;
+
+uint32_t FullyAssociativeCache::number_of_buckets(unsigned cacheLines) {
+    // At least two buckets per line keeps the chains at about one line
+    uint32_t buckets = 2;
+    while (buckets < 2 * cacheLines) {
+        buckets <<= 1;
+    }
+    return buckets;
+}
+
+FullyAssociativeCache::FullyAssociativeCache(unsigned cacheLines, CacheConfig cacheConfig, bool hugePages)
+    : arena(Arena::size_for(cacheLines + 2, sizeof(Line)) + Arena::size_for(number_of_buckets(cacheLines), sizeof(Line*)) +
+            Arena::size_for(cacheLines, 1u << cacheConfig.numberOfOffsetBits), hugePages) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+    numOfCacheLines = cacheLines;
+    numberOfBuckets = number_of_buckets(cacheLines);
+    bucketShift = 32 - __builtin_ctz(numberOfBuckets);
+    lines = arena.allocate_array<Line>(cacheLines + 2);
+    buckets = arena.allocate_array<Line*>(numberOfBuckets);
+    uint8_t* lineStorage = static_cast<uint8_t*>(arena.allocate(cacheLines * lineSize));
+
+    // Dummy head and tail around the lines, all of them invalid and outside the hash table
+    head = &lines[cacheLines];
+    tail = &lines[cacheLines + 1];
+    head->next = tail;
+    tail->prev = head;
+    for (unsigned i = 0; i < cacheLines; i++) {
+        lines[i].data = &lineStorage[i * lineSize];
+        add_line(&lines[i]);
+    }
+}
+
+uint32_t FullyAssociativeCache::bucket_of(uint32_t tag) const {
+    // Fibonacci hashing: the high bits of the product spread consecutive tags over the buckets
+    return (tag * 2654435769u) >> bucketShift;
+}
+
+FullyAssociativeCache::Line* FullyAssociativeCache::find(uint32_t tag) const {
+    for (Line* line = buckets[bucket_of(tag)]; line; line = line->hashNext) {
+        if (line->tag == tag) {
+            return line;
+        }
+    }
+    return nullptr;
+}
+
+void FullyAssociativeCache::unhash(Line* line) {
+    Line** link = &buckets[bucket_of(line->tag)];
+    while (*link != line) {
+        link = &(*link)->hashNext;
+    }
+    *link = line->hashNext;
+    line->hashNext = nullptr;
+}
+
+void FullyAssociativeCache::update_to_mru(Line* line) {
+    remove_line(line);
+    add_line(line);
+}
+
+void FullyAssociativeCache::remove_line(Line* line) {
+    line->prev->next = line->next;
+    line->next->prev = line->prev;
+}
+
+void FullyAssociativeCache::add_line(Line* line) {
+    line->next = head->next;
+    line->next->prev = line;
+    line->prev = head;
+    head->next = line;
+}
+
+unsigned FullyAssociativeCache::replace_lru(uint32_t address, uint32_t tag, CacheConfig cacheConfig, uint64_t sectorsToFetch) {
+    // Reuse the LRU line in place, it keeps its position and data buffer
+    Line* line = tail->prev;
+    if (line->valid) {
+        unhash(line);
+    }
+
+    line->tag = tag;
+    line->valid = true;
+    line->isPrefetched = false;
+    uint32_t bucket = bucket_of(tag);
+    line->hashNext = buckets[bucket];
+    buckets[bucket] = line;
+
+    uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+    line->validSectors = sectorsToFetch;
+    return CacheBase::fetch_sectors(line->data, lineAddress, sectorsToFetch, cacheConfig);
+}
+
+FullyAssociativeCache::Line* FullyAssociativeCache::lookup(uint32_t address, uint32_t size, CacheAddress cacheAddress, CacheConfig cacheConfig, Result &result) {
+    uint64_t sectorMask = CacheBase::sector_mask(cacheAddress.offset, size, cacheConfig);
+
+    lastAccess = AccessInfo();
+    Line* line = find(cacheAddress.tag);
+    if (!line) {
+        lastAccess.sectorsFetched = replace_lru(address, cacheAddress.tag, cacheConfig, sectorMask);
+        result.misses++;
+        repeatLine.remember(address, tail->prev->data, tail->prev->validSectors, cacheConfig);
+        return tail->prev;
+    }
+
+    // Sectored line: the tag matches but an accessed sector has not been fetched yet
+    if ((line->validSectors & sectorMask) != sectorMask) {
+        uint32_t lineAddress = (address >> cacheConfig.numberOfOffsetBits) << cacheConfig.numberOfOffsetBits;
+        lastAccess.sectorsFetched = CacheBase::fetch_sectors(line->data, lineAddress, sectorMask & ~line->validSectors, cacheConfig);
+        lastAccess.sectorMiss = true;
+        line->validSectors |= sectorMask;
+        result.misses++;
+    } else {
+        result.hits++;
+    }
+
+    lastAccess.prefetchedHit = line->isPrefetched && !lastAccess.sectorMiss;
+    line->isPrefetched = false;
+    repeatLine.remember(address, line->data, line->validSectors, cacheConfig);
+    return line;
+}
+
+uint32_t FullyAssociativeCache::read_from_cache(uint32_t address, CacheConfig cacheConfig, Result &result) {
+    CacheAddress cacheAddress(address, cacheConfig);
+    Line* line = lookup(address, 4, cacheAddress, cacheConfig, result);
+    update_to_mru(line);
+
+    uint8_t* data = &line->data[cacheAddress.offset];
+    return CacheBase::merge_data_to_uint32(data[0], data[1], data[2], data[3]);
+}
+
+void FullyAssociativeCache::write_to_cache(uint32_t address, CacheConfig cacheConfig, uint32_t dataToWrite, Result &result) {
+    CacheAddress cacheAddress(address, cacheConfig);
+    Line* line = lookup(address, 4, cacheAddress, cacheConfig, result);
+    update_to_mru(line);
+
+    // Write-through in little-endian byte order
+    for (uint32_t i = 0; i < 4; i++) {
+        uint8_t byteOfData = static_cast<uint8_t>((dataToWrite >> (8 * i)) & 0xFF);
+        line->data[cacheAddress.offset + i] = byteOfData;
+        mainMemory->write_to_ram(address + i, byteOfData);
+    }
+}
+
+bool FullyAssociativeCache::prefetch(uint32_t address, CacheConfig cacheConfig) {
+    repeatLine.forget();
+    CacheAddress cacheAddress(address, cacheConfig);
+    if (find(cacheAddress.tag)) {
+        return false;
+    }
+
+    // Insert the prefetched line as MRU so that it survives until its first use
+    replace_lru(address, cacheAddress.tag, cacheConfig, CacheBase::all_sectors(cacheConfig));
+    Line* line = tail->prev;
+    line->isPrefetched = true;
+    update_to_mru(line);
+    return true;
+}
+
+uint8_t* FullyAssociativeCache::access_line(uint32_t address, uint32_t size, CacheConfig cacheConfig, Result &result) {
+    CacheAddress cacheAddress(address, cacheConfig);
+    Line* line = lookup(address, size, cacheAddress, cacheConfig, result);
+    update_to_mru(line);
+    return line->data;
+}
+
+void FullyAssociativeCache::save_state(CheckpointWriter &writer, CacheConfig cacheConfig) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+    writer.put(static_cast<uint32_t>(numOfCacheLines));
+    for (Line* line = head->next; line != tail; line = line->next) {
+        writer.put(line->tag);
+        writer.put(static_cast<uint8_t>(line->valid));
+        writer.put(static_cast<uint8_t>(line->isPrefetched));
+        writer.put(line->validSectors);
+        writer.put_bytes(line->data, lineSize);
+    }
+}
+
+bool FullyAssociativeCache::load_state(CheckpointReader &reader, CacheConfig cacheConfig) {
+    uint32_t lineSize = 1u << cacheConfig.numberOfOffsetBits;
+    if (reader.get<uint32_t>() != numOfCacheLines) {
+        return false;
+    }
+    repeatLine.forget();
+
+    // Unlink all lines, keeping the dummy head and tail
+    head->next = tail;
+    tail->prev = head;
+    memset(buckets, 0, numberOfBuckets * sizeof(Line*));
+
+    // Rebuild the list from MRU to LRU by appending in front of the tail
+    for (unsigned i = 0; i < numOfCacheLines && reader.ok(); i++) {
+        Line* line = &lines[i];
+        line->tag = reader.get<uint32_t>();
+        line->valid = reader.get<uint8_t>() != 0;
+        line->isPrefetched = reader.get<uint8_t>() != 0;
+        line->validSectors = reader.get<uint64_t>();
+        line->hashNext = nullptr;
+
+        line->next = tail;
+        line->prev = tail->prev;
+        tail->prev->next = line;
+        tail->prev = line;
+        if (line->valid) {
+            uint32_t bucket = bucket_of(line->tag);
+            line->hashNext = buckets[bucket];
+            buckets[bucket] = line;
+        }
+
+        const uint8_t* lineData = reader.get_bytes(lineSize);
+        if (!lineData) {
+            return false;
+        }
+        memcpy(line->data, lineData, lineSize);
+    }
+    return reader.ok();
+}
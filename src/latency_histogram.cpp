@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cmath>
+
+#include "../includes/latency_histogram.hpp"
+
+using namespace std;
+
+#define SUB_BUCKETS (1u << LATENCY_SUB_BUCKET_BITS)
+
+static unsigned bucket_index(size_t cycles) {
+    if (cycles < SUB_BUCKETS) {
+        return static_cast<unsigned>(cycles);
+    }
+
+    // The magnitude selects the power of two, the bits below the leading one the sub-bucket
+    unsigned leadingBit = 63 - __builtin_clzll(static_cast<unsigned long long>(cycles));
+    unsigned shift = leadingBit - LATENCY_SUB_BUCKET_BITS;
+    return ((shift + 1) << LATENCY_SUB_BUCKET_BITS) + ((cycles >> shift) & (SUB_BUCKETS - 1));
+}
+
+static size_t bucket_upper_bound(unsigned index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    unsigned shift = (index >> LATENCY_SUB_BUCKET_BITS) - 1;
+    size_t lowerBound = static_cast<size_t>(SUB_BUCKETS + (index & (SUB_BUCKETS - 1))) << shift;
+    return lowerBound + (static_cast<size_t>(1) << shift) - 1;
+}
+
+void latency_record(LatencyHistogram* histogram, size_t cycles) {
+    histogram->counts[bucket_index(cycles)]++;
+    histogram->requests++;
+    histogram->totalCycles += cycles;
+    histogram->maxCycles = max(histogram->maxCycles, cycles);
+}
+
+void latency_merge(LatencyHistogram* into, const LatencyHistogram* from) {
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->requests += from->requests;
+    into->totalCycles += from->totalCycles;
+    into->maxCycles = max(into->maxCycles, from->maxCycles);
+}
+
+size_t latency_percentile(const LatencyHistogram* histogram, double percentile) {
+    if (histogram->requests == 0) {
+        return 0;
+    }
+
+    // Smallest bucket that covers the rank of the percentile, never above the largest recorded latency
+    size_t rank = static_cast<size_t>(ceil(percentile / 100.0 * histogram->requests));
+    rank = max<size_t>(rank, 1);
+    size_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            return min(bucket_upper_bound(i), histogram->maxCycles);
+        }
+    }
+    return histogram->maxCycles;
+}
+
+double latency_mean(const LatencyHistogram* histogram) {
+    return histogram->requests ? static_cast<double>(histogram->totalCycles) / histogram->requests : 0.0;
+}
@@ -8,23 +8,86 @@
 #include <sys/stat.h>
 
 #include "../includes/io_structs.hpp"
+#include "../includes/profiler.hpp"
+#include "../includes/latency_histogram.hpp"
+#include "../includes/daemon.hpp"
+#include "../includes/trace_import.hpp"
+#include "../includes/autotune.hpp"
 
 extern Result run_simulation(int cycles, bool directMapped, unsigned cacheLines, unsigned cacheLineSize, 
                             unsigned cacheLatency, int memoryLatency, size_t numRequests, 
                             Request requests[], const char* tracefile);
 
+extern Result run_simulation_with_options(int cycles, bool directMapped, unsigned cacheLines, unsigned cacheLineSize,
+                            unsigned cacheLatency, int memoryLatency, size_t numRequests,
+                            Request requests[], const char* tracefile,
+                            const SimulationOptions* options, SimulationStatistics* statistics);
+
 const char* usageMsg = 
     "Usage: %s [options] <csv-path>\n"
     "\nOptions:\n"
     "-c, --cycles <value>        Number of simulated cycles.\n"
     "--directmapped              Simulates a direct-mapped cache.\n"
     "--fourway                   Simulates a four-way-associative cache.\n"
+    "--fully-associative         Simulates a fully-associative cache with LRU replacement.\n"
     "--cacheline-size <value>    Size for each cachelines in Byte.\n"
     "--cachelines <value>        Number of cachelines.\n"
     "--cache-latency <value>     Latency for cache in cycles.\n"
     "--memory-latency <value>    Latency for main memory in cycles.\n"
     "--tf=<tracefile_name>       A tracefile containing all signals from the simulation. (leave this empty for no Tracefile)\n"
+    "--verify                    Checks every read value against a flat reference memory and reports the first divergence.\n"
+    "--prefetcher <kind>         Hardware prefetcher: next-line, stride or stream (stream buffers).\n"
+    "--prefetch-degree <value>   Lines prefetched ahead, or depth of each stream buffer (default 1).\n"
+    "--mshrs <value>             Non-blocking cache with this many miss status holding registers.\n"
+    "--store-buffer <value>      Write-combining store buffer with this many line-sized entries in front of the main memory.\n"
+    "--issue-width <value>       Requests issued per cycle into the cache's request queue (enables the queued mode).\n"
+    "--cache-ports <value>       Accesses the cache starts per cycle in queued mode (default 1).\n"
+    "--queue-depth <value>       Capacity of the request queue (default 16).\n"
+    "--victim-entries <value>    Fully-associative victim buffer with this many lines (direct-mapped only).\n"
+    "--victim-latency <value>    Cycles a victim buffer hit adds to the access (default: cache latency).\n"
+    "--sector-size <value>       Sectored lines: a miss only fetches the sector of this size in Byte.\n"
+    "--save-checkpoint <file>    Writes the cache state and the written memory pages to file after the simulation.\n"
+    "--load-checkpoint <file>    Starts from a checkpoint taken with the same cache configuration instead of a cold cache.\n"
+    "--sample-interval <value>   Sampled mode: times one unit in detail per this many units, the rest is functional.\n"
+    "--sample-unit <value>       Requests per sampling unit (default 1000).\n"
+    "--sample-warmup <value>     Requests simulated in detail before each measured unit (default: sample unit).\n"
+    "--dram-timing <tRCD,tCAS,tRP> DRAM timing model in cycles instead of the constant memory latency.\n"
+    "--dram-channels <value>     DRAM channels (default 1).\n"
+    "--dram-banks <value>        DRAM banks per channel (default 8).\n"
+    "--dram-row-size <value>     DRAM row size in Byte (default 1024).\n"
+    "--dram-page <policy>        Row-buffer policy: open (default) or closed.\n"
+    "--bus-width <value>         Memory bus of this width in Byte, fills take longer for larger lines.\n"
+    "--bus-burst <value>         Beats per bus burst, transfers are padded to whole bursts (default 1).\n"
+    "--bus-ratio <value>         Cache cycles per bus beat (default 1).\n"
+    "--tlb <l1-entries,l1-ways,l2-entries,l2-ways> Translates addresses through an L1 and L2 TLB (L2 entries 0: no L2 TLB).\n"
+    "--page-size <size>          Page size: 4K (default) or 2M.\n"
+    "--l2-tlb-latency <value>    Cycles an L2 TLB lookup adds to an L1 TLB miss (default 2).\n"
+    "--walk-cache <value>        Page-walk cache with this many upper-level page-table entries.\n"
+    "--icache <organization,cachelines,cacheline-size,latency> Split instruction cache for the fetches of the trace,\n"
+    "                            organization directmapped, fourway or fully-associative. Without it the fetches\n"
+    "                            of din, lackey and binary traces are skipped, 'I' lines of a csv trace are not.\n"
+    "--way-mask <stream>=<mask>  Ways the stream may fill in the 4-way cache as a hexadecimal bit mask, repeatable.\n"
+    "                            A set has one way per tag bit, streams without a mask fill every way.\n"
+    "--huge-pages                Backs the cache line storage with huge pages if the system provides them.\n"
+    "--thread-engine             Runs the blocking cache as the SC_THREAD model instead of the clocked state machine.\n"
+    "--tlm                       Loosely-timed mode: requests are TLM-2.0 transactions with annotated delays.\n"
+    "                            The memory socket and its DMI pointer only supply the memory latency,\n"
+    "                            line data still moves through the main memory model.\n"
+    "--quantum <value>           Cycles the core may run ahead of the simulation time in --tlm mode (default 1000).\n"
+    "--latency-report            Prints latency percentiles and the AMAT split by read/write and hit/miss.\n"
+    "--profile                   Prints wall and CPU time, peak RSS and host performance counters per phase.\n"
+    "--daemon <socket-path>      Serves JSON-lines simulation requests on this Unix socket instead of simulating once.\n"
+    "--trace <name>=<csv-path>   Trace the daemon keeps loaded under name, repeatable.\n"
+    "--workers <value>           Simulations the daemon (default 1) or the auto-tuner (default: one per core) runs at the same time.\n"
+    "--autotune <objective>      Searches the cache geometry with the lowest cycles or amat within --gate-budget.\n"
+    "--gate-budget <value>       Primitive gates the auto-tuned cache may use.\n"
+    "--autotune-confirm <value>  Best functional estimates the auto-tuner simulates in detail besides the Pareto front (default 8).\n"
+    "--trace-format <format>     Format of the trace: csv (default), din (Dinero), lackey (valgrind) or binary (ChampSim).\n"
     "<csv-path>                  Path to .csv file that contains the simulation's inputs.\n"
+    "                            Lines are 'W, <addr>, <data>[, <size>]' or 'R, <addr>,[ , <size>]', size in Byte (default 4).\n"
+    "                            A write wider than 4 Byte stores the 32-bit data value repeatedly across its size.\n"
+    "                            'I, <addr>,[ , <size>]' is an instruction fetch. An optional 5th column is the stream (tenant).\n"
+    "                            Addresses of the other formats are folded into the simulated address space.\n"
     "-h, --help                  Prints a short description of the program's options and a usage example.\n\n";
         
 const char* helpMsg = 
@@ -150,9 +213,39 @@ void parse_data(const char* content, struct Request request[], int numberOfReque
         sscanf(line, "%1s,%x,%d", tempWE, &addr, &data);
         data = tempWE[0] == 'W' ? data : 0;
 
+        // Optional 4th column with the access width
+        unsigned size = 0;
+        const char* sizeColumn = strchr(line, ',');
+        sizeColumn = sizeColumn ? strchr(sizeColumn + 1, ',') : NULL;
+        sizeColumn = sizeColumn ? strchr(sizeColumn + 1, ',') : NULL;
+        if (sizeColumn && sscanf(sizeColumn + 1, "%u", &size) == 1) {
+            if (size == 0 || size > MAX_ACCESS_SIZE || (size & (size - 1)) != 0) {
+                fprintf(stderr, "Error in .csv line %d: access size should be a power of two up to %d Byte.\n", counter + 1, MAX_ACCESS_SIZE);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // Split accesses stay within the memory, an access may not run past its last Byte
+        unsigned width = size ? size : 4;
+        if (addr < MEMORY_SIZE && addr + width > MEMORY_SIZE) {
+            fprintf(stderr, "Error in .csv line %d: access of %u Byte at 0x%x crosses the end of the memory.\n", counter + 1, width, addr);
+            exit(EXIT_FAILURE);
+        }
+
+        // Optional 5th column with the stream (tenant) of the request
+        unsigned stream = 0;
+        const char* streamColumn = sizeColumn ? strchr(sizeColumn + 1, ',') : NULL;
+        if (streamColumn && sscanf(streamColumn + 1, "%u", &stream) == 1 && stream >= MAX_STREAMS) {
+            fprintf(stderr, "Error in .csv line %d: stream should be below %d.\n", counter + 1, MAX_STREAMS);
+            exit(EXIT_FAILURE);
+        }
+
         request[i].we = tempWE[0] == 'W' ? 1 : 0;
         request[i].addr = addr;
         request[i].data = data;
+        request[i].size = size;
+        request[i].fetch = tempWE[0] == 'I' ? 1 : 0;
+        request[i].stream = stream;
 
         line = strtok_r(NULL, "\n", &rest);
         (*linesRead)++;
@@ -161,6 +254,59 @@ void parse_data(const char* content, struct Request request[], int numberOfReque
     free(copyOfContent);
 }
 
+// Spellings of --trace-format, indexed by enum TraceFormat
+const char* traceFormatNames[] = {"csv", "din", "lackey", "binary"};
+
+Request* import_requests(const char* path, enum TraceFormat format, int fetches, size_t* numRequests) {
+    // The first pass only counts, so the requests array can be allocated once
+    long count = import_trace(path, format, NULL, 0, fetches);
+    if (count < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    Request* requests = (Request *) malloc((count > 0 ? count : 1) * sizeof(Request));
+    if (requests == NULL) {
+        fprintf(stderr, "Error allocating memory for requests array.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The second pass has to find the same requests, the file may have changed in between
+    long imported = import_trace(path, format, requests, count, fetches);
+    if (imported < 0 || imported > count) {
+        fprintf(stderr, "Error! Trace %s changed while it was imported.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    *numRequests = imported;
+    printf("Imported requests: %zu\n", *numRequests);
+    return requests;
+}
+
+void print_latency_line(const char* name, const LatencyHistogram* histogram) {
+    printf("%s: %zu requests, mean %.2f, p50 %zu, p99 %zu, p99.9 %zu, max %zu cycles\n", name, histogram->requests,
+           latency_mean(histogram), latency_percentile(histogram, 50.0), latency_percentile(histogram, 99.0),
+           latency_percentile(histogram, 99.9), histogram->maxCycles);
+}
+
+void print_latency_report(const SimulationStatistics* statistics) {
+    // Reads, writes and all requests are the merged hit and miss histograms
+    LatencyHistogram reads = {0};
+    LatencyHistogram writes = {0};
+    LatencyHistogram all = {0};
+    latency_merge(&reads, &statistics->latency[LATENCY_READ_HIT]);
+    latency_merge(&reads, &statistics->latency[LATENCY_READ_MISS]);
+    latency_merge(&writes, &statistics->latency[LATENCY_WRITE_HIT]);
+    latency_merge(&writes, &statistics->latency[LATENCY_WRITE_MISS]);
+    latency_merge(&all, &reads);
+    latency_merge(&all, &writes);
+
+    printf("AMAT: %.2f cycles (reads %.2f, writes %.2f)\n", latency_mean(&all), latency_mean(&reads), latency_mean(&writes));
+    print_latency_line("Latency", &all);
+    print_latency_line("Read Hit Latency", &statistics->latency[LATENCY_READ_HIT]);
+    print_latency_line("Read Miss Latency", &statistics->latency[LATENCY_READ_MISS]);
+    print_latency_line("Write Hit Latency", &statistics->latency[LATENCY_WRITE_HIT]);
+    print_latency_line("Write Miss Latency", &statistics->latency[LATENCY_WRITE_MISS]);
+}
+
 int main(int argc, char* const argv[]) {
     const char* progname = argv[0];
     
@@ -175,6 +321,8 @@ int main(int argc, char* const argv[]) {
     int cycles = 0;
     bool directMapped = false;
     bool fourway = false;
+    bool fullyAssociative = false;
+    bool partitioned = false;
     int cacheLineSize = 0;
     int cacheLines = 0;
     int cacheLatency = 0;
@@ -183,20 +331,78 @@ int main(int argc, char* const argv[]) {
     bool isTracefilePassed = false;
     char* csvPath = "";
     bool isCSVPassed = false;
-    char* CSVContent;
+    char* CSVContent = NULL;
+    enum TraceFormat traceFormat = TRACE_CSV;
     size_t numRequests = 0;
     Request* requests;
     int linesRead = 0;
+    SimulationOptions options = {0};
+    SimulationStatistics statistics = {0};
+    bool profile = false;
+    bool latencyReport = false;
+    char* daemonSocket = NULL;
+    char* daemonTracePaths[MAX_DAEMON_TRACES];
+    DaemonTrace daemonTraces[MAX_DAEMON_TRACES];
+    size_t numDaemonTraces = 0;
+    unsigned daemonWorkers = 1;
+    bool workersGiven = false;
+    AutotuneObjective autotune = AUTOTUNE_NONE;
+    size_t gateBudget = 0;
+    unsigned autotuneConfirm = 8;
 
     struct option longOptions[] = {
         {"cycles", required_argument, 0, 'c'},
         {"directmapped", no_argument, 0, 0},
         {"fourway", no_argument, 0, 0},
+        {"fully-associative", no_argument, 0, 0},
         {"cacheline-size", required_argument, 0, 0},
         {"cachelines", required_argument, 0, 0},
         {"cache-latency", required_argument, 0, 0},
         {"memory-latency", required_argument, 0, 0},
         {"tf", required_argument, 0, 0},
+        {"verify", no_argument, 0, 0},
+        {"prefetcher", required_argument, 0, 0},
+        {"prefetch-degree", required_argument, 0, 0},
+        {"mshrs", required_argument, 0, 0},
+        {"store-buffer", required_argument, 0, 0},
+        {"issue-width", required_argument, 0, 0},
+        {"cache-ports", required_argument, 0, 0},
+        {"queue-depth", required_argument, 0, 0},
+        {"victim-entries", required_argument, 0, 0},
+        {"victim-latency", required_argument, 0, 0},
+        {"sector-size", required_argument, 0, 0},
+        {"save-checkpoint", required_argument, 0, 0},
+        {"load-checkpoint", required_argument, 0, 0},
+        {"sample-interval", required_argument, 0, 0},
+        {"sample-unit", required_argument, 0, 0},
+        {"sample-warmup", required_argument, 0, 0},
+        {"dram-timing", required_argument, 0, 0},
+        {"dram-channels", required_argument, 0, 0},
+        {"dram-banks", required_argument, 0, 0},
+        {"dram-row-size", required_argument, 0, 0},
+        {"dram-page", required_argument, 0, 0},
+        {"bus-width", required_argument, 0, 0},
+        {"bus-burst", required_argument, 0, 0},
+        {"bus-ratio", required_argument, 0, 0},
+        {"tlb", required_argument, 0, 0},
+        {"page-size", required_argument, 0, 0},
+        {"l2-tlb-latency", required_argument, 0, 0},
+        {"walk-cache", required_argument, 0, 0},
+        {"icache", required_argument, 0, 0},
+        {"way-mask", required_argument, 0, 0},
+        {"huge-pages", no_argument, 0, 0},
+        {"thread-engine", no_argument, 0, 0},
+        {"tlm", no_argument, 0, 0},
+        {"quantum", required_argument, 0, 0},
+        {"profile", no_argument, 0, 0},
+        {"latency-report", no_argument, 0, 0},
+        {"daemon", required_argument, 0, 0},
+        {"trace", required_argument, 0, 0},
+        {"workers", required_argument, 0, 0},
+        {"autotune", required_argument, 0, 0},
+        {"gate-budget", required_argument, 0, 0},
+        {"autotune-confirm", required_argument, 0, 0},
+        {"trace-format", required_argument, 0, 0},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -216,15 +422,18 @@ int main(int argc, char* const argv[]) {
             print_help(progname);
             return 0;
         case 0:
-            if (strcmp(longOptions[optionIndex].name, "directmapped") == 0 || strcmp(longOptions[optionIndex].name, "fourway") == 0) {
+            if (strcmp(longOptions[optionIndex].name, "directmapped") == 0 || strcmp(longOptions[optionIndex].name, "fourway") == 0 ||
+                strcmp(longOptions[optionIndex].name, "fully-associative") == 0) {
                  if (strcmp(longOptions[optionIndex].name, "directmapped") == 0) {
                     directMapped = true;
-                } else {
+                } else if (strcmp(longOptions[optionIndex].name, "fourway") == 0) {
                     fourway = true;
+                } else {
+                    fullyAssociative = true;
                 }
 
-                if (directMapped && fourway) {
-                    fprintf(stderr, "Error! Cache can't be direct mapped and 4-way associative at the same time.\n");
+                if (directMapped + fourway + fullyAssociative > 1) {
+                    fprintf(stderr, "Error! Cache can only have one of direct-mapped, 4-way and fully-associative organization.\n");
                     exit(EXIT_FAILURE);
                 } 
             }
@@ -278,6 +487,388 @@ int main(int argc, char* const argv[]) {
                 tracefile = optarg;
                 isTracefilePassed = true;
             }
+
+            if (strcmp(longOptions[optionIndex].name, "verify") == 0) {
+                options.verify = 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "prefetcher") == 0) {
+                if (strcmp(optarg, "next-line") == 0) {
+                    options.prefetcher = PREFETCHER_NEXT_LINE;
+                } else if (strcmp(optarg, "stride") == 0) {
+                    options.prefetcher = PREFETCHER_STRIDE;
+                } else if (strcmp(optarg, "stream") == 0) {
+                    options.prefetcher = PREFETCHER_STREAM_BUFFER;
+                } else {
+                    fprintf(stderr, "Error! Prefetcher should be next-line, stride or stream.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "prefetch-degree") == 0) {
+                int fetchedNumber = fetch_num("prefetch-degree");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Prefetch degree should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.prefetchDegree = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "mshrs") == 0) {
+                int fetchedNumber = fetch_num("mshrs");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of MSHRs should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.mshrs = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "store-buffer") == 0) {
+                int fetchedNumber = fetch_num("store-buffer");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of store buffer entries should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.storeBufferEntries = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "issue-width") == 0) {
+                int fetchedNumber = fetch_num("issue-width");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Issue width should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.issueWidth = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "cache-ports") == 0) {
+                int fetchedNumber = fetch_num("cache-ports");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of cache ports should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.cachePorts = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "queue-depth") == 0) {
+                int fetchedNumber = fetch_num("queue-depth");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Queue depth should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.queueDepth = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "victim-entries") == 0) {
+                int fetchedNumber = fetch_num("victim-entries");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of victim entries should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.victimEntries = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "victim-latency") == 0) {
+                int fetchedNumber = fetch_num("victim-latency");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Victim latency value should be greater than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.victimLatency = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "sector-size") == 0) {
+                int fetchedNumber = fetch_num("sector-size");
+                if (fetchedNumber < 4 || (fetchedNumber & (fetchedNumber - 1)) != 0) {
+                    fprintf(stderr, "Error! Sector size should be a power of two and at least 4.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.sectorSize = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "save-checkpoint") == 0) {
+                options.saveCheckpoint = optarg;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "load-checkpoint") == 0) {
+                options.loadCheckpoint = optarg;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "sample-interval") == 0) {
+                int fetchedNumber = fetch_num("sample-interval");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Sample interval should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.sampleInterval = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "sample-unit") == 0) {
+                int fetchedNumber = fetch_num("sample-unit");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Sample unit should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.sampleUnit = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "sample-warmup") == 0) {
+                int fetchedNumber = fetch_num("sample-warmup");
+                if (fetchedNumber < 0) {
+                    fprintf(stderr, "Error! Sample warmup should not be negative.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.sampleWarmup = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "dram-timing") == 0) {
+                if (sscanf(optarg, "%u,%u,%u", &options.dramTRCD, &options.dramTCAS, &options.dramTRP) != 3 || options.dramTCAS == 0) {
+                    fprintf(stderr, "Error! DRAM timing should be given as tRCD,tCAS,tRP with tCAS larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.dram = 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "dram-channels") == 0) {
+                int fetchedNumber = fetch_num("dram-channels");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of DRAM channels should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.dramChannels = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "dram-banks") == 0) {
+                int fetchedNumber = fetch_num("dram-banks");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of DRAM banks should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.dramBanks = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "dram-row-size") == 0) {
+                int fetchedNumber = fetch_num("dram-row-size");
+                if (fetchedNumber <= 0 || (fetchedNumber & (fetchedNumber - 1)) != 0) {
+                    fprintf(stderr, "Error! DRAM row size should be a power of two.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.dramRowSize = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "dram-page") == 0) {
+                if (strcmp(optarg, "open") == 0) {
+                    options.dramClosedPage = 0;
+                } else if (strcmp(optarg, "closed") == 0) {
+                    options.dramClosedPage = 1;
+                } else {
+                    fprintf(stderr, "Error! DRAM page policy should be open or closed.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "bus-width") == 0) {
+                int fetchedNumber = fetch_num("bus-width");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Bus width should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.busWidth = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "bus-burst") == 0) {
+                int fetchedNumber = fetch_num("bus-burst");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Bus burst length should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.busBurstLength = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "bus-ratio") == 0) {
+                int fetchedNumber = fetch_num("bus-ratio");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Bus ratio should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.busRatio = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "tlb") == 0) {
+                if (sscanf(optarg, "%u,%u,%u,%u", &options.l1TlbEntries, &options.l1TlbWays, &options.l2TlbEntries, &options.l2TlbWays) != 4 ||
+                    options.l1TlbWays == 0 || options.l1TlbEntries == 0 || options.l1TlbEntries % options.l1TlbWays != 0 ||
+                    (options.l2TlbEntries > 0 && (options.l2TlbWays == 0 || options.l2TlbEntries % options.l2TlbWays != 0))) {
+                    fprintf(stderr, "Error! TLBs should be given as l1-entries,l1-ways,l2-entries,l2-ways with entries a multiple of the ways.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.mmu = 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "page-size") == 0) {
+                if (strcmp(optarg, "4K") == 0) {
+                    options.pageSize = 4096;
+                } else if (strcmp(optarg, "2M") == 0) {
+                    options.pageSize = 2097152;
+                } else {
+                    fprintf(stderr, "Error! Page size should be 4K or 2M.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "l2-tlb-latency") == 0) {
+                int fetchedNumber = fetch_num("l2-tlb-latency");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! L2 TLB latency should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.l2TlbLatency = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "walk-cache") == 0) {
+                int fetchedNumber = fetch_num("walk-cache");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Number of page-walk cache entries should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.walkCacheEntries = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "icache") == 0) {
+                char organization[32];
+                if (sscanf(optarg, "%31[^,],%u,%u,%u", organization, &options.icacheLines, &options.icacheLineSize,
+                           &options.icacheLatency) != 4 || options.icacheLines == 0 || options.icacheLatency == 0) {
+                    fprintf(stderr, "Error! Instruction cache should be given as organization,cachelines,cacheline-size,latency.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.icacheDirectMapped = strcmp(organization, "directmapped") == 0;
+                options.icacheFullyAssociative = strcmp(organization, "fully-associative") == 0;
+                if (!options.icacheDirectMapped && !options.icacheFullyAssociative && strcmp(organization, "fourway") != 0) {
+                    fprintf(stderr, "Error! Instruction cache organization should be directmapped, fourway or fully-associative.\n");
+                    exit(EXIT_FAILURE);
+                } else if (options.icacheLineSize == 0 || options.icacheLineSize % 4 != 0) {
+                    fprintf(stderr, "Error! Instruction cacheline size should be a multiple of 4.\n");
+                    exit(EXIT_FAILURE);
+                } else if (strcmp(organization, "fourway") == 0 && (options.icacheLines < 4 || options.icacheLines % 4 != 0)) {
+                    fprintf(stderr, "Error! For a 4-way associative instruction cache, cachelines value should be multiple of 4.\n");
+                    exit(EXIT_FAILURE);
+                } else if (options.icacheDirectMapped && (options.icacheLines & (options.icacheLines - 1)) != 0) {
+                    fprintf(stderr, "Error! For a direct-mapped instruction cache, cachelines value should be power of two.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "way-mask") == 0) {
+                unsigned stream;
+                uint32_t mask;
+                if (sscanf(optarg, "%u=%x", &stream, &mask) != 2 || stream >= MAX_STREAMS || mask == 0) {
+                    fprintf(stderr, "Error! Way masks should be given as stream=mask with a stream below %d and a non-zero mask.\n", MAX_STREAMS);
+                    exit(EXIT_FAILURE);
+                }
+                options.wayMasks[stream] = mask;
+                partitioned = true;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "huge-pages") == 0) {
+                options.hugePages = 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "thread-engine") == 0) {
+                options.threadEngine = 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "tlm") == 0) {
+                options.tlm = 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "quantum") == 0) {
+                int fetchedNumber = fetch_num("quantum");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Quantum should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                options.tlmQuantum = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "profile") == 0) {
+                profile = true;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "latency-report") == 0) {
+                latencyReport = true;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "daemon") == 0) {
+                daemonSocket = optarg;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "trace") == 0) {
+                char* separator = strchr(optarg, '=');
+                if (separator == NULL || separator == optarg || separator[1] == '\0') {
+                    fprintf(stderr, "Error! Traces should be given as <name>=<csv-path>.\n");
+                    exit(EXIT_FAILURE);
+                }
+                if (numDaemonTraces == MAX_DAEMON_TRACES) {
+                    fprintf(stderr, "Error! At most %d traces can be loaded.\n", MAX_DAEMON_TRACES);
+                    exit(EXIT_FAILURE);
+                }
+                *separator = '\0';
+                daemonTraces[numDaemonTraces].name = optarg;
+                daemonTracePaths[numDaemonTraces++] = separator + 1;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "workers") == 0) {
+                int fetchedNumber = fetch_num("workers");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Workers should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                daemonWorkers = fetchedNumber;
+                workersGiven = true;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "autotune") == 0) {
+                if (strcmp(optarg, "cycles") == 0) {
+                    autotune = AUTOTUNE_CYCLES;
+                } else if (strcmp(optarg, "amat") == 0) {
+                    autotune = AUTOTUNE_AMAT;
+                } else {
+                    fprintf(stderr, "Error! Auto-tuning objective should be cycles or amat.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "gate-budget") == 0) {
+                int fetchedNumber = fetch_num("gate-budget");
+                if (fetchedNumber <= 0) {
+                    fprintf(stderr, "Error! Gate budget should be larger than 0.\n");
+                    exit(EXIT_FAILURE);
+                }
+                gateBudget = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "autotune-confirm") == 0) {
+                int fetchedNumber = fetch_num("autotune-confirm");
+                if (fetchedNumber < 0) {
+                    fprintf(stderr, "Error! Number of confirmed candidates should not be negative.\n");
+                    exit(EXIT_FAILURE);
+                }
+                autotuneConfirm = fetchedNumber;
+            }
+
+            if (strcmp(longOptions[optionIndex].name, "trace-format") == 0) {
+                if (strcmp(optarg, traceFormatNames[TRACE_CSV]) == 0) {
+                    traceFormat = TRACE_CSV;
+                } else if (strcmp(optarg, traceFormatNames[TRACE_DIN]) == 0) {
+                    traceFormat = TRACE_DIN;
+                } else if (strcmp(optarg, traceFormatNames[TRACE_LACKEY]) == 0) {
+                    traceFormat = TRACE_LACKEY;
+                } else if (strcmp(optarg, traceFormatNames[TRACE_BINARY]) == 0) {
+                    traceFormat = TRACE_BINARY;
+                } else {
+                    fprintf(stderr, "Error! Trace format should be csv, din, lackey or binary.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
             break;
         default:
             print_usage(progname);
@@ -291,15 +882,162 @@ int main(int argc, char* const argv[]) {
         isCSVPassed = true;
     }
 
-    // Check if all options have been initialized
-    if (cycles == 0 || directMapped == fourway || cacheLineSize == 0 || cacheLines == 0 || cacheLatency == 0 || memoryLatency == 0 || !isCSVPassed) {
+    // Daemon mode: parse every trace once, the cache configurations arrive over the socket
+    if (daemonSocket) {
+        if (numDaemonTraces == 0) {
+            fprintf(stderr, "Error! The daemon needs at least one --trace.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < numDaemonTraces; i++) {
+            if (traceFormat != TRACE_CSV) {
+                daemonTraces[i].requests = import_requests(daemonTracePaths[i], traceFormat, 0, &daemonTraces[i].numRequests);
+                continue;
+            }
+            char* content = read_csv(daemonTracePaths[i]);
+            if (!content) {
+                fprintf(stderr, "Error reading .csv file %s.\n", daemonTracePaths[i]);
+                exit(EXIT_FAILURE);
+            }
+            daemonTraces[i].numRequests = count_num_of_request(content);
+            daemonTraces[i].requests = (Request *) malloc(daemonTraces[i].numRequests * sizeof(Request));
+            if (daemonTraces[i].requests == NULL) {
+                fprintf(stderr, "Error allocating memory for requests array.\n");
+                exit(EXIT_FAILURE);
+            }
+            parse_data(content, daemonTraces[i].requests, daemonTraces[i].numRequests, &linesRead);
+            free(content);
+        }
+        return run_daemon(daemonSocket, daemonTraces, numDaemonTraces, daemonWorkers);
+    }
+
+    // Check if all options have been initialized, the auto-tuner picks the organization and geometry itself
+    bool geometryMissing = directMapped + fourway + fullyAssociative != 1 || cacheLineSize == 0 || cacheLines == 0;
+    if (cycles == 0 || (autotune ? gateBudget == 0 : geometryMissing) || cacheLatency == 0 || memoryLatency == 0 || !isCSVPassed) {
         fprintf(stderr, "Error! Not all options have been correctly initialized!\n");
         fprintf(stderr, "Type <program name> -h or --help for options.\n");
         exit(EXIT_FAILURE);
     }
+    options.fullyAssociative = fullyAssociative;
+
+    if (autotune && (options.loadCheckpoint || options.saveCheckpoint)) {
+        fprintf(stderr, "Error! Checkpoints are bound to one cache configuration, they are not available with --autotune.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (autotune && (directMapped || fourway || fullyAssociative || cacheLines != 0 || cacheLineSize != 0)) {
+        fprintf(stderr, "Error! The auto-tuner picks the organization and geometry itself, they can't be given with --autotune.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (autotune && options.storeBufferEntries > 0) {
+        fprintf(stderr, "Error! The functional estimate of the auto-tuner has no store buffer, it is not available with --autotune.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.victimEntries > 0 && !directMapped && !autotune) {
+        fprintf(stderr, "Error! The victim buffer is only available for the direct-mapped cache.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options.victimLatency > 0 && (options.victimLatency < (unsigned) cacheLatency || options.victimLatency > (unsigned) memoryLatency)) {
+        fprintf(stderr, "Error! Victim latency should be between cache latency and memory latency.\n");
+        exit(EXIT_FAILURE);
+    }
 
-    // Check if csvPath is passed
-    if (csvPath) {
+    if (options.sectorSize > 0 && !autotune) {
+        unsigned lineSizeRoundedUp = 1;
+        while (lineSizeRoundedUp < (unsigned) cacheLineSize) {
+            lineSizeRoundedUp <<= 1;
+        }
+        if (options.sectorSize > lineSizeRoundedUp || lineSizeRoundedUp / options.sectorSize > 64) {
+            fprintf(stderr, "Error! Sector size should not exceed the cacheline size, with at most 64 sectors per cacheline.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (partitioned && !fourway && !autotune) {
+        fprintf(stderr, "Error! Way masks are only available for the 4-way cache.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (partitioned && !autotune) {
+        // A set of the 4-way cache holds one way per tag bit, the auto-tuner checks the masks per candidate
+        uint32_t span = 1;
+        while (span < (uint32_t) cacheLineSize) {
+            span <<= 1;
+        }
+        for (uint32_t sets = 1; sets < (uint32_t) cacheLines / 4; sets <<= 1) {
+            span <<= 1;
+        }
+        unsigned waysPerSet = 0;
+        for (; span < MEMORY_SIZE; span <<= 1) {
+            waysPerSet++;
+        }
+        for (unsigned stream = 0; stream < MAX_STREAMS; stream++) {
+            if (waysPerSet < 32 && (options.wayMasks[stream] >> waysPerSet) != 0) {
+                fprintf(stderr, "Error! The way mask of stream %u selects ways beyond the %u ways of a set.\n", stream, waysPerSet);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    if (options.icacheLines > 0 && (options.loadCheckpoint || options.saveCheckpoint)) {
+        fprintf(stderr, "Error! Checkpoints only hold the data cache, they are not available with an instruction cache.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.sampleInterval > 0) {
+        if (options.issueWidth > 0) {
+            fprintf(stderr, "Error! The sampled mode is only available without the request queue.\n");
+            exit(EXIT_FAILURE);
+        }
+        options.sampleUnit = options.sampleUnit ? options.sampleUnit : 1000;
+        options.sampleWarmup = options.sampleWarmup ? options.sampleWarmup : options.sampleUnit;
+    }
+
+    if (options.tlm) {
+        if (options.issueWidth > 0 || options.sampleInterval > 0) {
+            fprintf(stderr, "Error! The loosely-timed mode is only available without the request queue and sampling.\n");
+            exit(EXIT_FAILURE);
+        }
+        options.tlmQuantum = options.tlmQuantum ? options.tlmQuantum : 1000;
+    }
+
+    if (options.mmu) {
+        options.pageSize = options.pageSize ? options.pageSize : 4096;
+        options.l2TlbLatency = options.l2TlbLatency ? options.l2TlbLatency : 2;
+
+        // VIPT: the set index has to come from the page offset, otherwise a line could be cached under two sets
+        unsigned sets = directMapped ? cacheLines : (fourway ? cacheLines / 4 : 1);
+        unsigned lineSizeRoundedUp = 1;
+        while (lineSizeRoundedUp < (unsigned) cacheLineSize) {
+            lineSizeRoundedUp <<= 1;
+        }
+        if ((uint64_t) sets * lineSizeRoundedUp > options.pageSize) {
+            fprintf(stderr, "Error! A virtually indexed cache needs sets times cacheline size of at most the page size.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // The instruction cache is indexed the same way
+        unsigned icacheSets = options.icacheDirectMapped ? options.icacheLines
+                            : (options.icacheFullyAssociative ? 1 : options.icacheLines / 4);
+        unsigned icacheLineSizeRoundedUp = 1;
+        while (icacheLineSizeRoundedUp < options.icacheLineSize) {
+            icacheLineSizeRoundedUp <<= 1;
+        }
+        if (options.icacheLines > 0 && (uint64_t) icacheSets * icacheLineSizeRoundedUp > options.pageSize) {
+            fprintf(stderr, "Error! A virtually indexed instruction cache needs sets times cacheline size of at most the page size.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (profile) {
+        profiler_enable();
+    }
+    profiler_begin(PROFILE_INPUT);
+
+    // Check if csvPath is passed, the other trace formats are imported without reading the whole file
+    if (traceFormat != TRACE_CSV) {
+        CSVContent = NULL;
+    } else if (csvPath) {
         CSVContent = read_csv(csvPath);
         if (!CSVContent) {
             fprintf(stderr, "Error reading .csv file.\n");
@@ -314,26 +1052,71 @@ int main(int argc, char* const argv[]) {
     printf("Cycles: %d\n", cycles);
     printf("Direct mapped: %d\n", directMapped);
     printf("Fourway: %d\n", fourway);
+    printf("Fully Associative: %d\n", fullyAssociative);
     printf("Cacheline Size: %d\n", cacheLineSize);
     printf("Cachelines: %d\n", cacheLines);
     printf("Cache Latency: %d\n", cacheLatency);
     printf("Memory Latency: %d\n", memoryLatency);
     printf("Tracefile Name: %s\n", tracefile);
     printf("Path to .csv file: %s\n", csvPath);
+    printf("Verify: %d\n", options.verify);
+    printf("Prefetcher: %d (degree %u)\n", options.prefetcher, options.prefetchDegree ? options.prefetchDegree : 1);
+    printf("MSHRs: %u\n", options.mshrs);
+    printf("Store Buffer Entries: %u\n", options.storeBufferEntries);
+    printf("Issue Width: %u\n", options.issueWidth);
+    printf("Victim Entries: %u\n", options.victimEntries);
+    printf("Sector Size: %u\n", options.sectorSize);
+    printf("Load Checkpoint: %s\n", options.loadCheckpoint ? options.loadCheckpoint : "");
+    printf("Save Checkpoint: %s\n", options.saveCheckpoint ? options.saveCheckpoint : "");
+    printf("Sample Interval: %u (unit %u, warmup %u)\n", options.sampleInterval, options.sampleUnit, options.sampleWarmup);
+    printf("DRAM: %d (tRCD %u, tCAS %u, tRP %u, %s page)\n", options.dram, options.dramTRCD, options.dramTCAS, options.dramTRP,
+           options.dramClosedPage ? "closed" : "open");
+    printf("Bus Width: %u (burst %u, ratio %u)\n", options.busWidth, options.busBurstLength ? options.busBurstLength : 1,
+           options.busRatio ? options.busRatio : 1);
+    printf("TLB: %d (L1 %u/%u-way, L2 %u/%u-way, %u Byte pages, walk cache %u)\n", options.mmu, options.l1TlbEntries, options.l1TlbWays,
+           options.l2TlbEntries, options.l2TlbWays, options.pageSize, options.walkCacheEntries);
+    printf("Instruction Cache: %u lines of %u Byte (%s, latency %u)\n", options.icacheLines, options.icacheLineSize,
+           options.icacheDirectMapped ? "direct-mapped" : (options.icacheFullyAssociative ? "fully-associative" : "4-way"),
+           options.icacheLatency);
+    printf("Way Masks:");
+    for (unsigned stream = 0; stream < MAX_STREAMS; stream++) {
+        printf(" %x", options.wayMasks[stream]);
+    }
+    printf("\n");
+    printf("Huge Pages: %d\n", options.hugePages);
+    printf("Thread Engine: %d\n", options.threadEngine);
+    printf("TLM: %d (quantum %u)\n", options.tlm, options.tlmQuantum);
+    printf("Profile: %d\n", profile);
+    printf("Latency Report: %d\n", latencyReport);
+    printf("Trace Format: %s\n", traceFormatNames[traceFormat]);
     
-    numRequests = count_num_of_request(CSVContent);
-    requests = (Request *) malloc(numRequests * sizeof(Request));
+    if (traceFormat != TRACE_CSV) {
+        requests = import_requests(csvPath, traceFormat, options.icacheLines > 0, &numRequests);
+    } else {
+        numRequests = count_num_of_request(CSVContent);
+        requests = (Request *) malloc(numRequests * sizeof(Request));
 
-    // Allocate memory in heap for requests array
-    if (requests == NULL) {
-        fprintf(stderr, "Error allocating memory for requests array.\n");
-        free(CSVContent);
-        exit(EXIT_FAILURE);
+        // Allocate memory in heap for requests array
+        if (requests == NULL) {
+            fprintf(stderr, "Error allocating memory for requests array.\n");
+            free(CSVContent);
+            exit(EXIT_FAILURE);
+        }
+
+        parse_data(CSVContent, requests, numRequests, &linesRead);
     }
+    profiler_end(PROFILE_INPUT);
 
-    parse_data(CSVContent, requests, numRequests, &linesRead);
+    if (autotune) {
+        int status = run_autotune(cycles, cacheLatency, memoryLatency, numRequests, requests, &options, autotune, gateBudget,
+                                  autotuneConfirm, workersGiven ? daemonWorkers : 0);
+        free(CSVContent);
+        free(requests);
+        return status;
+    }
 
-    Result result = run_simulation(cycles, directMapped, cacheLines, cacheLineSize, cacheLatency, memoryLatency, numRequests, requests, tracefile);
+    Result result = run_simulation_with_options(cycles, directMapped, cacheLines, cacheLineSize, cacheLatency, memoryLatency,
+                                                numRequests, requests, tracefile, &options, &statistics);
 
     printf("\nSimulation Results: \n");
     printf("Cycles: %zu\n", result.cycles);
@@ -341,9 +1124,137 @@ int main(int argc, char* const argv[]) {
     printf("Hits: %zu\n", result.hits);
     printf("Primitive Gate Count: %zu\n", result.primitiveGateCount);
 
+    if (options.prefetcher != PREFETCHER_NONE) {
+        size_t useful = statistics.usefulPrefetches;
+        printf("Prefetches Issued: %zu\n", statistics.prefetchesIssued);
+        printf("Useful Prefetches: %zu (%zu late)\n", useful, statistics.latePrefetches);
+        printf("Prefetch Accuracy: %.2f%%\n", statistics.prefetchesIssued ? 100.0 * useful / statistics.prefetchesIssued : 0.0);
+        printf("Prefetch Coverage: %.2f%%\n", (useful + statistics.uncoveredMisses) ? 100.0 * useful / (useful + statistics.uncoveredMisses) : 0.0);
+    }
+
+    if (options.mshrs > 0) {
+        printf("MSHR Allocations: %zu\n", statistics.mshrAllocations);
+        printf("MSHR Merges: %zu\n", statistics.mshrMerges);
+        printf("MSHR Stall Cycles: %zu\n", statistics.mshrStallCycles);
+        printf("MSHR Occupancy: %.2f average, %zu peak\n",
+               result.cycles ? (double) statistics.mshrOccupancyCycles / result.cycles : 0.0, statistics.mshrPeakOccupancy);
+    }
+
+    if (options.storeBufferEntries > 0) {
+        printf("Store Buffer Stores: %zu (%.2f%% combined)\n", statistics.storeBufferStores,
+               statistics.storeBufferStores ? 100.0 * statistics.storeBufferCombines / statistics.storeBufferStores : 0.0);
+        printf("Store Buffer Drains: %zu (%zu Byte)\n", statistics.storeBufferDrains, statistics.storeBufferDrainedBytes);
+        printf("Store Buffer Full Stalls: %zu (%zu cycles)\n", statistics.storeBufferFullStalls, statistics.storeBufferStallCycles);
+        printf("Store Buffer Forwarded Loads: %zu\n", statistics.storeBufferForwards);
+        printf("Store Buffer Occupancy: %.2f average, %zu peak\n",
+               result.cycles ? (double) statistics.storeBufferOccupancyCycles / result.cycles : 0.0, statistics.storeBufferPeakOccupancy);
+    }
+
+    if (options.victimEntries > 0) {
+        printf("Victim Hits: %zu\n", statistics.victimHits);
+    }
+
+    if (options.sectorSize > 0) {
+        printf("Sector Misses: %zu\n", statistics.sectorMisses);
+        printf("Fill Traffic: %zu Byte (%zu sectors)\n", statistics.sectorsFetched * options.sectorSize, statistics.sectorsFetched);
+    }
+
+    if (options.sampleInterval > 0) {
+        printf("Sampled Units: %zu (%zu of %zu requests timed in detail, %zu cycles)\n",
+               statistics.sampledUnits, statistics.detailedRequests, numRequests, statistics.detailedCycles);
+        printf("Cycles Confidence Interval: +-%.0f (95%%, +-%.2f%%)\n", statistics.cyclesConfidenceInterval,
+               result.cycles ? 100.0 * statistics.cyclesConfidenceInterval / result.cycles : 0.0);
+    }
+
+    if (options.dram) {
+        size_t dramAccesses = statistics.dramRowHits + statistics.dramRowEmpty + statistics.dramRowConflicts;
+        printf("DRAM Row Hits: %zu (%.2f%%)\n", statistics.dramRowHits, dramAccesses ? 100.0 * statistics.dramRowHits / dramAccesses : 0.0);
+        printf("DRAM Row Empty: %zu\n", statistics.dramRowEmpty);
+        printf("DRAM Row Conflicts: %zu\n", statistics.dramRowConflicts);
+        printf("DRAM Queueing Cycles: %zu\n", statistics.dramQueueCycles);
+    }
+
+    if (options.busWidth > 0) {
+        printf("Bus Utilization: %.2f%% (%zu transfers, %zu Byte)\n",
+               result.cycles ? 100.0 * statistics.busBusyCycles / result.cycles : 0.0, statistics.busTransfers, statistics.busBytes);
+        printf("Bus Queueing Delay: %.2f cycles average\n",
+               statistics.busTransfers ? (double) statistics.busQueueCycles / statistics.busTransfers : 0.0);
+    }
+
+    if (options.mmu) {
+        size_t l1TlbLookups = statistics.l1TlbHits + statistics.l1TlbMisses;
+        size_t l2TlbLookups = statistics.l2TlbHits + statistics.l2TlbMisses;
+        size_t pageWalks = options.l2TlbEntries > 0 ? statistics.l2TlbMisses : statistics.l1TlbMisses;
+        printf("L1 TLB Hits: %zu (%.2f%%)\n", statistics.l1TlbHits, l1TlbLookups ? 100.0 * statistics.l1TlbHits / l1TlbLookups : 0.0);
+        if (options.l2TlbEntries > 0) {
+            printf("L2 TLB Hits: %zu (%.2f%%)\n", statistics.l2TlbHits, l2TlbLookups ? 100.0 * statistics.l2TlbHits / l2TlbLookups : 0.0);
+        }
+        printf("Page Walks: %zu (%zu walk cache hits)\n", pageWalks, statistics.walkCacheHits);
+        printf("Walk Loads: %zu (%zu cache misses, %zu victim buffer hits)\n", statistics.walkLoads, statistics.walkLoadMisses,
+               statistics.walkLoadVictimHits);
+        printf("Walk Cycles: %zu (%.2f per walk)\n", statistics.walkCycles, pageWalks ? (double) statistics.walkCycles / pageWalks : 0.0);
+    }
+
+    if (options.icacheLines > 0) {
+        size_t fetches = statistics.instructionHits + statistics.instructionMisses;
+        size_t dataAccesses = result.hits + result.misses - fetches;
+        printf("Instruction Cache Hits: %zu (%.2f%%)\n", statistics.instructionHits, fetches ? 100.0 * statistics.instructionHits / fetches : 0.0);
+        printf("Instruction Cache Misses: %zu\n", statistics.instructionMisses);
+        printf("Data Cache Hits: %zu (%.2f%%)\n", result.hits - statistics.instructionHits,
+               dataAccesses ? 100.0 * (result.hits - statistics.instructionHits) / dataAccesses : 0.0);
+        printf("Data Cache Misses: %zu\n", result.misses - statistics.instructionMisses);
+    }
+
+    // Per-stream results once the trace interleaves streams or the ways are partitioned
+    unsigned streams = 0;
+    for (size_t i = 0; i < numRequests; i++) {
+        streams = requests[i].stream >= streams ? requests[i].stream + 1 : streams;
+    }
+    if (streams > 1 || partitioned) {
+        for (unsigned stream = 0; stream < streams; stream++) {
+            size_t accesses = statistics.streamHits[stream] + statistics.streamMisses[stream];
+            printf("Stream %u: %zu hits, %zu misses (%.2f%% hit rate)", stream, statistics.streamHits[stream],
+                   statistics.streamMisses[stream], accesses ? 100.0 * statistics.streamHits[stream] / accesses : 0.0);
+            if (fourway) {
+                printf(", %.1f lines occupied on average", statistics.occupancySamples ?
+                       (double) statistics.streamOccupancy[stream] / statistics.occupancySamples : 0.0);
+            }
+            printf("\n");
+        }
+    }
+
+    if (statistics.splitAccesses > 0) {
+        printf("Split Accesses: %zu\n", statistics.splitAccesses);
+    }
+
+    if (options.issueWidth > 0) {
+        printf("Bandwidth: %.3f accesses per cycle\n", result.cycles ? (double) numRequests / result.cycles : 0.0);
+        printf("Average Request Latency: %.2f cycles (max %zu)\n",
+               numRequests ? (double) statistics.totalRequestLatency / numRequests : 0.0, statistics.maxRequestLatency);
+        printf("Out-of-Order Completions: %zu\n", statistics.outOfOrderCompletions);
+        printf("Queue Full Stalls: %zu\n", statistics.queueFullStalls);
+    }
+
+    if (latencyReport) {
+        print_latency_report(&statistics);
+    }
+
+    if (options.verify) {
+        if (statistics.divergences == 0) {
+            printf("Verification: passed (%zu reads checked)\n", statistics.verifiedReads);
+        } else {
+            printf("Verification: FAILED, %zu of %zu reads diverged\n", statistics.divergences, statistics.verifiedReads);
+            printf("First divergence at request %zu, address 0x%X: expected %u but got %u\n",
+                   statistics.firstDivergenceIndex, statistics.firstDivergenceAddress,
+                   statistics.expectedData, statistics.actualData);
+        }
+    }
+
+    profiler_report(statistics.processedRequests);
+
     // Free resources
     free(CSVContent);
     free(requests);
 
-    return 0;
+    return (options.verify && statistics.divergences != 0) ? EXIT_FAILURE : 0;
 }
\ No newline at end of file
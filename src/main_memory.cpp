@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cmath>
+#include <cstring>
 
 #include "../includes/main_memory.hpp"
 
@@ -7,8 +8,8 @@ using namespace std;
 
 MainMemory::MainMemory(unsigned cacheAddressLength) {
     memorySize = static_cast<uint32_t>(pow(2, cacheAddressLength));
-    data = new uint8_t[memorySize];
-    
+    data = new uint8_t[memorySize]();
+    touchedPages.resize((memorySize + MEMORY_PAGE_SIZE - 1) / MEMORY_PAGE_SIZE, false);
 }
 
 MainMemory::~MainMemory() {
@@ -27,6 +28,58 @@ uint8_t MainMemory::read_from_ram(uint32_t address) {
 void MainMemory::write_to_ram(uint32_t address, uint8_t dataToWrite) {
     if (address >= memorySize) {
         cerr << "Error: Invalid memory address " << address << endl;
+        return;
     }
     data[address] = dataToWrite;
+    touchedPages[address / MEMORY_PAGE_SIZE] = true;
 }   
+
+void MainMemory::write_span(uint32_t address, const uint8_t* dataToWrite, uint32_t size) {
+    if (address + size > memorySize) {
+        cerr << "Error: Invalid memory address " << address + size - 1 << endl;
+        return;
+    }
+    memcpy(&data[address], dataToWrite, size);
+    for (uint32_t page = address / MEMORY_PAGE_SIZE; page <= (address + size - 1) / MEMORY_PAGE_SIZE; page++) {
+        touchedPages[page] = true;
+    }
+}
+
+void MainMemory::read_span(uint32_t address, uint8_t* dataToRead, uint32_t size) {
+    if (address + size > memorySize) {
+        for (uint32_t i = 0; i < size; i++) {
+            dataToRead[i] = read_from_ram(address + i);
+        }
+        return;
+    }
+    memcpy(dataToRead, &data[address], size);
+}
+
+void MainMemory::save_pages(CheckpointWriter &writer) {
+    uint32_t numberOfPages = 0;
+    for (bool touched : touchedPages) {
+        numberOfPages += touched ? 1 : 0;
+    }
+
+    writer.put(numberOfPages);
+    for (uint32_t page = 0; page < touchedPages.size(); page++) {
+        if (touchedPages[page]) {
+            writer.put(page);
+            writer.put_bytes(&data[page * MEMORY_PAGE_SIZE], MEMORY_PAGE_SIZE);
+        }
+    }
+}
+
+bool MainMemory::load_pages(CheckpointReader &reader) {
+    uint32_t numberOfPages = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < numberOfPages && reader.ok(); i++) {
+        uint32_t page = reader.get<uint32_t>();
+        const uint8_t* pageData = reader.get_bytes(MEMORY_PAGE_SIZE);
+        if (!pageData || page >= touchedPages.size()) {
+            return false;
+        }
+        memcpy(&data[page * MEMORY_PAGE_SIZE], pageData, MEMORY_PAGE_SIZE);
+        touchedPages[page] = true;
+    }
+    return reader.ok();
+}
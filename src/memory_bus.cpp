@@ -0,0 +1,36 @@
+#include <algorithm>
+
+#include "../includes/memory_bus.hpp"
+
+using namespace std;
+
+MemoryBus::MemoryBus(const SimulationOptions* options, SimulationStatistics* statistics)
+    : width(options->busWidth), busFreeCycle(0), statistics(statistics) {
+    burstLength = options->busBurstLength > 0 ? options->busBurstLength : 1;
+    ratio = options->busRatio > 0 ? options->busRatio : 1;
+}
+
+unsigned MemoryBus::transfer_cycles(uint32_t bytes) const {
+    uint32_t bytesPerBurst = width * burstLength;
+    uint32_t bursts = (bytes + bytesPerBurst - 1) / bytesPerBurst;
+    return bursts * burstLength * ratio;
+}
+
+size_t MemoryBus::transfer(size_t readyCycle, uint32_t bytes) {
+    size_t start = max(readyCycle, busFreeCycle);
+    unsigned cycles = transfer_cycles(bytes);
+    statistics->busQueueCycles += start - readyCycle;
+    statistics->busBusyCycles += cycles;
+    statistics->busTransfers++;
+    statistics->busBytes += bytes;
+    busFreeCycle = start + cycles;
+    return busFreeCycle;
+}
+
+size_t MemoryBus::read(size_t readyCycle, uint32_t bytes) {
+    return transfer(readyCycle, bytes);
+}
+
+void MemoryBus::write(size_t cycle, uint32_t bytes) {
+    transfer(cycle, bytes);
+}
@@ -0,0 +1,140 @@
+#include "../includes/mmu.hpp"
+
+using namespace std;
+
+Tlb::Tlb(unsigned entries, unsigned ways) : ways(ways), useCounter(0) {
+    sets = entries / ways;
+    this->entries.resize(sets * ways);
+}
+
+bool Tlb::lookup(uint32_t virtualPage) {
+    Entry* set = &entries[(virtualPage % sets) * ways];
+    for (unsigned way = 0; way < ways; way++) {
+        if (set[way].valid && set[way].virtualPage == virtualPage) {
+            set[way].lastUse = ++useCounter;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Tlb::insert(uint32_t virtualPage) {
+    // Fill an invalid way first, otherwise replace the least recently used one
+    Entry* set = &entries[(virtualPage % sets) * ways];
+    Entry* victim = &set[0];
+    for (unsigned way = 0; way < ways; way++) {
+        if (!set[way].valid) {
+            victim = &set[way];
+            break;
+        }
+        if (set[way].lastUse < victim->lastUse) {
+            victim = &set[way];
+        }
+    }
+    victim->valid = true;
+    victim->virtualPage = virtualPage;
+    victim->lastUse = ++useCounter;
+}
+
+MMU::MMU(const SimulationOptions* options, uint32_t memorySize, SimulationStatistics* statistics,
+         function<unsigned(uint32_t, size_t)> walkLoad)
+    : l1Tlb(options->l1TlbEntries, options->l1TlbWays), statistics(statistics), walkLoad(walkLoad) {
+    l2Tlb = options->l2TlbEntries > 0 ? new Tlb(options->l2TlbEntries, options->l2TlbWays) : nullptr;
+    l2TlbLatency = options->l2TlbLatency;
+    pageOffsetBits = __builtin_ctz(options->pageSize);
+    leafLevel = pageOffsetBits > level_shift(1) ? 2 : 1;
+    walkCacheEntries = options->walkCacheEntries;
+    walkCacheUse = 0;
+
+    // One table per level at the top of the main memory, from the leaf level up to the root in the highest frame
+    unsigned tables = PAGE_TABLE_LEVELS - leafLevel + 1;
+    pageTableBase = memorySize > tables * PAGE_TABLE_SIZE ? memorySize - tables * PAGE_TABLE_SIZE : 0;
+}
+
+MMU::~MMU() {
+    delete l2Tlb;
+}
+
+unsigned MMU::level_shift(unsigned level) {
+    return 12 + PAGE_TABLE_INDEX_BITS * (level - 1);
+}
+
+bool MMU::walk_cache_lookup(unsigned level, uint32_t virtualAddress) {
+    uint64_t key = (static_cast<uint64_t>(level) << 32) | (static_cast<uint64_t>(virtualAddress) >> level_shift(level));
+    for (auto &entry : walkCache) {
+        if (entry.first == key) {
+            entry.second = ++walkCacheUse;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MMU::walk_cache_insert(unsigned level, uint32_t virtualAddress) {
+    uint64_t key = (static_cast<uint64_t>(level) << 32) | (static_cast<uint64_t>(virtualAddress) >> level_shift(level));
+    if (walkCache.size() < walkCacheEntries) {
+        walkCache.push_back({key, ++walkCacheUse});
+        return;
+    }
+    auto victim = walkCache.begin();
+    for (auto it = walkCache.begin(); it != walkCache.end(); it++) {
+        if (it->second < victim->second) {
+            victim = it;
+        }
+    }
+    *victim = {key, ++walkCacheUse};
+}
+
+unsigned MMU::walk(uint32_t virtualAddress, size_t cycle) {
+    // Start below the lowest non-leaf level the walk cache holds an entry for
+    unsigned startLevel = PAGE_TABLE_LEVELS;
+    for (unsigned level = leafLevel + 1; walkCacheEntries > 0 && level <= PAGE_TABLE_LEVELS; level++) {
+        if (walk_cache_lookup(level, virtualAddress)) {
+            startLevel = level - 1;
+            statistics->walkCacheHits++;
+            break;
+        }
+    }
+
+    unsigned cycles = 0;
+    for (unsigned level = startLevel; level >= leafLevel; level--) {
+        uint32_t table = pageTableBase + (level - leafLevel) * PAGE_TABLE_SIZE;
+        uint32_t index = (static_cast<uint64_t>(virtualAddress) >> level_shift(level)) & ((1u << PAGE_TABLE_INDEX_BITS) - 1);
+        // Every level needs the entry of the level above, the loads are serialized
+        cycles += walkLoad(table + index * PAGE_TABLE_ENTRY_SIZE, cycle + cycles);
+        statistics->walkLoads++;
+        if (level > leafLevel && walkCacheEntries > 0) {
+            walk_cache_insert(level, virtualAddress);
+        }
+    }
+    return cycles;
+}
+
+unsigned MMU::translate(uint32_t virtualAddress, uint32_t &physicalAddress, size_t cycle) {
+    physicalAddress = virtualAddress;
+    uint32_t virtualPage = virtualAddress >> pageOffsetBits;
+    if (l1Tlb.lookup(virtualPage)) {
+        statistics->l1TlbHits++;
+        return 0;
+    }
+    statistics->l1TlbMisses++;
+
+    unsigned cycles = 0;
+    if (l2Tlb) {
+        cycles += l2TlbLatency;
+        if (l2Tlb->lookup(virtualPage)) {
+            statistics->l2TlbHits++;
+            l1Tlb.insert(virtualPage);
+            return cycles;
+        }
+        statistics->l2TlbMisses++;
+    }
+
+    unsigned walkCycles = walk(virtualAddress, cycle + cycles);
+    statistics->walkCycles += walkCycles;
+    if (l2Tlb) {
+        l2Tlb->insert(virtualPage);
+    }
+    l1Tlb.insert(virtualPage);
+    return cycles + walkCycles;
+}
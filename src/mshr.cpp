@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include "../includes/mshr.hpp"
+
+using namespace std;
+
+MissStatusHoldingRegisters::MissStatusHoldingRegisters(unsigned numberOfEntries, SimulationStatistics* statistics)
+    : numberOfEntries(numberOfEntries), statistics(statistics) {
+    entries.reserve(numberOfEntries);
+}
+
+void MissStatusHoldingRegisters::tick(size_t cycle) {
+    entries.erase(remove_if(entries.begin(), entries.end(), [cycle](const Entry &entry) { return entry.readyCycle <= cycle; }),
+                  entries.end());
+
+    statistics->mshrOccupancyCycles += entries.size();
+    statistics->mshrPeakOccupancy = max(statistics->mshrPeakOccupancy, entries.size());
+}
+
+bool MissStatusHoldingRegisters::merge(uint32_t lineAddress, size_t cycle, size_t* readyCycle) {
+    for (auto &entry : entries) {
+        if (entry.lineAddress == lineAddress && entry.readyCycle > cycle) {
+            statistics->mshrMerges++;
+            if (readyCycle) {
+                *readyCycle = entry.readyCycle;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned MissStatusHoldingRegisters::allocate(uint32_t lineAddress, size_t cycle, unsigned penalty) {
+    // A secondary miss waits for the fill of the primary miss
+    size_t readyCycle;
+    if (merge(lineAddress, cycle, &readyCycle)) {
+        return static_cast<unsigned>(readyCycle - cycle);
+    }
+    statistics->mshrAllocations++;
+
+    if (entries.size() < numberOfEntries) {
+        entries.push_back({lineAddress, cycle + penalty});
+        return 0;
+    }
+
+    // All entries are busy: stall until the earliest fill arrives and reuse its entry
+    auto earliest = min_element(entries.begin(), entries.end(),
+                                [](const Entry &a, const Entry &b) { return a.readyCycle < b.readyCycle; });
+    unsigned stall = earliest->readyCycle > cycle ? static_cast<unsigned>(earliest->readyCycle - cycle) : 0;
+    earliest->lineAddress = lineAddress;
+    earliest->readyCycle = cycle + stall + penalty;
+    statistics->mshrStallCycles += stall;
+    return stall;
+}
+
+size_t MissStatusHoldingRegisters::drain(size_t cycle) {
+    size_t lastReadyCycle = cycle;
+    for (auto &entry : entries) {
+        lastReadyCycle = max(lastReadyCycle, entry.readyCycle);
+    }
+    for (size_t drainCycle = cycle; drainCycle < lastReadyCycle; drainCycle++) {
+        tick(drainCycle);
+    }
+    entries.clear();
+    return lastReadyCycle - cycle;
+}
+
+size_t MissStatusHoldingRegisters::occupancy() const {
+    return entries.size();
+}
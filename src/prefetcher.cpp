@@ -0,0 +1,244 @@
+#include <cmath>
+
+#include "../includes/prefetcher.hpp"
+
+using namespace std;
+
+Prefetcher::Prefetcher(CacheBase* cache, CacheConfig cacheConfig, unsigned memoryLatency, uint32_t memorySize,
+                       unsigned degree, SimulationStatistics* statistics)
+    : cache(cache), cacheConfig(cacheConfig), memoryLatency(memoryLatency), memorySize(memorySize),
+      degree(degree > 0 ? degree : 1), statistics(statistics) {
+    lineSize = static_cast<uint32_t>(pow(2, cacheConfig.numberOfOffsetBits));
+}
+
+Prefetcher* Prefetcher::create(PrefetcherKind kind, CacheBase* cache, CacheConfig cacheConfig, unsigned memoryLatency,
+                               uint32_t memorySize, unsigned degree, SimulationStatistics* statistics) {
+    switch (kind) {
+    case PREFETCHER_NEXT_LINE:
+        return new NextLinePrefetcher(cache, cacheConfig, memoryLatency, memorySize, degree, statistics);
+    case PREFETCHER_STRIDE:
+        return new StridePrefetcher(cache, cacheConfig, memoryLatency, memorySize, degree, statistics);
+    case PREFETCHER_STREAM_BUFFER:
+        return new StreamBufferPrefetcher(cache, cacheConfig, memoryLatency, memorySize, degree, statistics);
+    default:
+        return nullptr;
+    }
+}
+
+uint32_t Prefetcher::line_address(uint32_t address) const {
+    return address & ~(lineSize - 1);
+}
+
+unsigned Prefetcher::fill_latency(uint32_t lineAddress, size_t cycle) {
+    return memoryFill ? memoryFill(lineAddress, lineSize, memoryLatency, cycle) : memoryLatency;
+}
+
+void Prefetcher::issue(uint32_t lineAddress, size_t cycle) {
+    if (lineAddress >= memorySize || memorySize - lineAddress < lineSize) {
+        return;
+    }
+    if (!cache->prefetch(lineAddress, cacheConfig)) {
+        return;
+    }
+    statistics->prefetchesIssued++;
+
+    // Forget prefetches that arrived long ago and were evicted before their first use
+    if (inFlight.size() > 4096) {
+        for (auto it = inFlight.begin(); it != inFlight.end();) {
+            it = (it->second <= cycle) ? inFlight.erase(it) : next(it);
+        }
+    }
+    inFlight[lineAddress] = cycle + fill_latency(lineAddress, cycle);
+}
+
+bool Prefetcher::serve_miss(uint32_t lineAddress, size_t cycle, size_t &readyCycle) {
+    return false;
+}
+
+bool Prefetcher::holds_line(uint32_t lineAddress) const {
+    return false;
+}
+
+unsigned Prefetcher::access(uint32_t address, bool miss, bool prefetchedHit, size_t cycle, unsigned missLatency) {
+    uint32_t lineAddress = line_address(address);
+    bool coveredByPrefetch = prefetchedHit;
+    size_t readyCycle = cycle;
+
+    if (miss) {
+        coveredByPrefetch = serve_miss(lineAddress, cycle, readyCycle);
+        if (!coveredByPrefetch) {
+            statistics->uncoveredMisses++;
+            readyCycle = cycle + missLatency;
+        }
+    } else if (prefetchedHit) {
+        auto it = inFlight.find(lineAddress);
+        if (it != inFlight.end()) {
+            readyCycle = it->second;
+            inFlight.erase(it);
+        }
+    }
+
+    // A prefetch that is used before its data arrived only hides part of the latency
+    if (coveredByPrefetch) {
+        statistics->usefulPrefetches++;
+        if (readyCycle > cycle) {
+            statistics->latePrefetches++;
+        }
+    }
+
+    train(address, miss, prefetchedHit, cycle);
+    return readyCycle > cycle ? readyCycle - cycle : 0;
+}
+
+void NextLinePrefetcher::train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) {
+    if (!miss && !prefetchedHit) {
+        return;
+    }
+    uint32_t lineAddress = line_address(address);
+    for (unsigned i = 1; i <= degree; i++) {
+        issue(lineAddress + i * lineSize, cycle);
+    }
+}
+
+void StridePrefetcher::train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) {
+    // Find the entry whose last address is closest to the current one
+    Entry* entry = nullptr;
+    uint32_t closestDistance = MAX_DISTANCE + 1;
+    for (auto &candidate : table) {
+        uint32_t distance = (address > candidate.lastAddress) ? address - candidate.lastAddress : candidate.lastAddress - address;
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            entry = &candidate;
+        }
+    }
+
+    // Allocate a new entry by replacing the least recently used one
+    if (entry == nullptr) {
+        if (table.size() < TABLE_ENTRIES) {
+            table.push_back(Entry());
+            entry = &table.back();
+        } else {
+            entry = &table[0];
+            for (auto &candidate : table) {
+                if (candidate.lastUse < entry->lastUse) {
+                    entry = &candidate;
+                }
+            }
+        }
+        entry->lastAddress = address;
+        entry->stride = 0;
+        entry->state = INITIAL;
+        entry->lastUse = cycle;
+        return;
+    }
+
+    int32_t stride = static_cast<int32_t>(address) - static_cast<int32_t>(entry->lastAddress);
+    if (stride == 0) {
+        entry->lastUse = cycle;
+        return;
+    }
+
+    if (stride == entry->stride) {
+        entry->state = STEADY;
+    } else {
+        entry->state = (entry->state == STEADY) ? TRANSIENT : INITIAL;
+        entry->stride = stride;
+    }
+    entry->lastAddress = address;
+    entry->lastUse = cycle;
+
+    if (entry->state != STEADY) {
+        return;
+    }
+
+    // Prefetch the lines of the next accesses along the stride, skipping the current line
+    uint32_t currentLine = line_address(address);
+    int64_t nextAddress = address;
+    for (unsigned i = 0; i < degree; i++) {
+        nextAddress += stride;
+        if (nextAddress < 0 || nextAddress >= memorySize) {
+            break;
+        }
+        uint32_t lineAddress = line_address(static_cast<uint32_t>(nextAddress));
+        if (lineAddress != currentLine) {
+            issue(lineAddress, cycle);
+        }
+    }
+}
+
+void StreamBufferPrefetcher::refill(StreamBuffer &buffer, size_t slot, uint32_t lineAddress, size_t cycle) {
+    // Lines outside the main memory can never match a demand miss
+    if (lineAddress >= memorySize || memorySize - lineAddress < lineSize) {
+        buffer.lineAddresses[slot] = UINT32_MAX;
+        return;
+    }
+    buffer.lineAddresses[slot] = lineAddress;
+    buffer.readyCycles[slot] = cycle + fill_latency(lineAddress, cycle);
+    statistics->prefetchesIssued++;
+}
+
+bool StreamBufferPrefetcher::holds_line(uint32_t lineAddress) const {
+    for (auto &buffer : buffers) {
+        if (buffer.valid && buffer.lineAddresses[buffer.head] == lineAddress) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StreamBufferPrefetcher::serve_miss(uint32_t lineAddress, size_t cycle, size_t &readyCycle) {
+    for (auto &buffer : buffers) {
+        if (!buffer.valid || buffer.lineAddresses[buffer.head] != lineAddress) {
+            continue;
+        }
+        readyCycle = buffer.readyCycles[buffer.head];
+        buffer.lastUse = cycle;
+
+        // Pop the head and append the line following the current tail
+        size_t tail = (buffer.head + degree - 1) % degree;
+        uint32_t tailAddress = buffer.lineAddresses[tail];
+        if (tailAddress == UINT32_MAX) {
+            buffer.lineAddresses[buffer.head] = UINT32_MAX;
+        } else {
+            refill(buffer, buffer.head, tailAddress + lineSize, cycle);
+        }
+        buffer.head = (buffer.head + 1) % degree;
+        lastMissServed = true;
+        return true;
+    }
+    lastMissServed = false;
+    return false;
+}
+
+void StreamBufferPrefetcher::train(uint32_t address, bool miss, bool prefetchedHit, size_t cycle) {
+    if (!miss || lastMissServed) {
+        return;
+    }
+
+    if (buffers.empty()) {
+        buffers.resize(STREAM_BUFFERS);
+    }
+
+    // Allocate the least recently used buffer for the stream starting after the missed line
+    StreamBuffer* victim = &buffers[0];
+    for (auto &buffer : buffers) {
+        if (!buffer.valid) {
+            victim = &buffer;
+            break;
+        }
+        if (buffer.lastUse < victim->lastUse) {
+            victim = &buffer;
+        }
+    }
+
+    victim->lineAddresses.assign(degree, UINT32_MAX);
+    victim->readyCycles.assign(degree, cycle);
+    victim->head = 0;
+    victim->lastUse = cycle;
+    victim->valid = true;
+
+    uint32_t lineAddress = line_address(address);
+    for (unsigned i = 0; i < degree; i++) {
+        refill(*victim, i, lineAddress + (i + 1) * lineSize, cycle);
+    }
+}
@@ -0,0 +1,177 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+#include "../includes/profiler.hpp"
+
+using namespace std;
+
+#define PROFILE_COUNTERS 4
+
+static const char* phaseNames[PROFILE_PHASES] = {"Input", "Elaboration", "Simulation", "Output"};
+static const char* counterNames[PROFILE_COUNTERS] = {"cycles", "instructions", "LLC misses", "branch misses"};
+static const uint64_t counterConfigs[PROFILE_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                          PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+struct Sample {
+    double wall;
+    double cpu;
+    uint64_t counters[PROFILE_COUNTERS];
+};
+
+struct PhaseTotals {
+    bool entered;
+    Sample sum;
+    Sample start;
+    long peakRssKiB;
+};
+
+struct Profiler {
+    bool enabled;
+    int counterFds[PROFILE_COUNTERS];
+    Sample start;
+    PhaseTotals phases[PROFILE_PHASES];
+};
+
+static Profiler profiler = {};
+
+static double seconds(clockid_t clock) {
+    struct timespec time;
+    clock_gettime(clock, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// User-space counters of this process, one event per file descriptor so that a missing one doesn't take the others along
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+static Sample sample() {
+    Sample current;
+    current.wall = seconds(CLOCK_MONOTONIC);
+    current.cpu = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        uint64_t value = 0;
+        if (profiler.counterFds[i] >= 0 && read(profiler.counterFds[i], &value, sizeof(value)) != sizeof(value)) {
+            value = 0;
+        }
+        current.counters[i] = value;
+    }
+    return current;
+}
+
+static long peak_rss_kib() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static bool counters_available() {
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        if (profiler.counterFds[i] >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_counters(const uint64_t counters[PROFILE_COUNTERS]) {
+    if (!counters_available()) {
+        return;
+    }
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        if (profiler.counterFds[i] < 0) {
+            printf("  %s: n/a", counterNames[i]);
+        } else {
+            printf("  %s: %llu", counterNames[i], static_cast<unsigned long long>(counters[i]));
+        }
+    }
+    if (profiler.counterFds[0] >= 0 && profiler.counterFds[1] >= 0 && counters[0] > 0) {
+        printf("  IPC: %.2f", static_cast<double>(counters[1]) / counters[0]);
+    }
+    printf("\n");
+}
+
+void profiler_enable(void) {
+    profiler.enabled = true;
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        profiler.counterFds[i] = open_counter(counterConfigs[i]);
+    }
+    profiler.start = sample();
+}
+
+void profiler_begin(ProfilePhase phase) {
+    if (!profiler.enabled) {
+        return;
+    }
+    profiler.phases[phase].entered = true;
+    profiler.phases[phase].start = sample();
+}
+
+void profiler_end(ProfilePhase phase) {
+    if (!profiler.enabled) {
+        return;
+    }
+    Sample end = sample();
+    PhaseTotals &totals = profiler.phases[phase];
+    totals.sum.wall += end.wall - totals.start.wall;
+    totals.sum.cpu += end.cpu - totals.start.cpu;
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        totals.sum.counters[i] += end.counters[i] - totals.start.counters[i];
+    }
+    totals.peakRssKiB = peak_rss_kib();
+}
+
+void profiler_report(size_t simulatedRequests) {
+    if (!profiler.enabled) {
+        return;
+    }
+    Sample end = sample();
+
+    printf("\nProfile:\n");
+    if (!counters_available()) {
+        printf("Host counters unavailable (perf_event_open failed, see /proc/sys/kernel/perf_event_paranoid)\n");
+    }
+    for (int phase = 0; phase < PROFILE_PHASES; phase++) {
+        const PhaseTotals &totals = profiler.phases[phase];
+        if (!totals.entered) {
+            continue;
+        }
+        printf("%s: %.3f ms wall, %.3f ms CPU, %ld KiB peak RSS\n", phaseNames[phase],
+               1e3 * totals.sum.wall, 1e3 * totals.sum.cpu, totals.peakRssKiB);
+        print_counters(totals.sum.counters);
+    }
+
+    uint64_t counters[PROFILE_COUNTERS];
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        counters[i] = end.counters[i] - profiler.start.counters[i];
+    }
+    printf("Total: %.3f ms wall, %.3f ms CPU, %ld KiB peak RSS\n", 1e3 * (end.wall - profiler.start.wall),
+           1e3 * (end.cpu - profiler.start.cpu), peak_rss_kib());
+    print_counters(counters);
+
+    double simulationSeconds = profiler.phases[PROFILE_SIMULATION].sum.wall;
+    printf("Simulated Requests per Host Second: %.0f\n", simulationSeconds > 0.0 ? simulatedRequests / simulationSeconds : 0.0);
+
+    // The report ends the profile
+    for (int i = 0; i < PROFILE_COUNTERS; i++) {
+        if (profiler.counterFds[i] >= 0) {
+            close(profiler.counterFds[i]);
+        }
+        profiler.counterFds[i] = -1;
+    }
+    profiler.enabled = false;
+}
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "../includes/reference_memory.hpp"
+
+using namespace std;
+
+ReferenceMemory::ReferenceMemory(unsigned cacheAddressLength) {
+    memorySize = static_cast<uint32_t>(pow(2, cacheAddressLength));
+
+    // Pad so that the widest access at the last address stays inside the array
+    data = new uint8_t[memorySize + MAX_ACCESS_SIZE - 1]();
+}
+
+ReferenceMemory::~ReferenceMemory() {
+    delete[] data;
+}
+
+void ReferenceMemory::copy_from(MainMemory &memory) {
+    for (uint32_t address = 0; address < memorySize; address++) {
+        data[address] = memory.read_from_ram(address);
+    }
+}
+
+void ReferenceMemory::write(uint32_t address, uint32_t dataToWrite, unsigned size) {
+    if (address >= memorySize) {
+        return;
+    }
+    size = (size == 0) ? 4 : size;
+    for (unsigned i = 0; i < size; i += sizeof(dataToWrite)) {
+        memcpy(&data[address + i], &dataToWrite, min<unsigned>(size - i, sizeof(dataToWrite)));
+    }
+}
+
+bool ReferenceMemory::check(size_t requestIndex, uint32_t address, unsigned size, uint32_t actualData, SimulationStatistics &statistics) {
+    if (address >= memorySize) {
+        return true;
+    }
+
+    uint32_t expectedData = 0;
+    size = (size == 0) ? 4 : size;
+    memcpy(&expectedData, &data[address], min<unsigned>(size, sizeof(expectedData)));
+    statistics.verifiedReads++;
+
+    if (expectedData == actualData) {
+        return true;
+    }
+
+    // Only the first divergence is kept, later ones are counted
+    if (statistics.divergences++ == 0) {
+        statistics.firstDivergenceIndex = requestIndex;
+        statistics.firstDivergenceAddress = address;
+        statistics.expectedData = expectedData;
+        statistics.actualData = actualData;
+    }
+    return false;
+}
@@ -1,8 +1,13 @@
 #include <systemc>
 #include <iostream>
+#include <cmath>
 
 #include "../includes/io_structs.hpp"
 #include "../includes/cache_module.hpp"
+#include "../includes/reference_memory.hpp"
+#include "../includes/tlm_memory.hpp"
+#include "../includes/tlm_initiator.hpp"
+#include "../includes/profiler.hpp"
 #define MATRIX_SIZE 4
 
 using namespace std;
@@ -63,11 +68,27 @@ int sc_main(int argc, char* argv[]) {
 
 Result run_simulation(int cycles, bool directMapped,  unsigned cacheLines, unsigned cacheLineSize, unsigned cacheLatency,
                              int memoryLatency, size_t numRequests, Request requests[], const char* tracefile) {
+    SimulationOptions options = {};
+    SimulationStatistics statistics = {};
+    return run_simulation_with_options(cycles, directMapped, cacheLines, cacheLineSize, cacheLatency, memoryLatency,
+                                       numRequests, requests, tracefile, &options, &statistics);
+}
+
+Result run_simulation_with_options(int cycles, bool directMapped,  unsigned cacheLines, unsigned cacheLineSize, unsigned cacheLatency,
+                             int memoryLatency, size_t numRequests, Request requests[], const char* tracefile,
+                             const SimulationOptions* options, SimulationStatistics* statistics) {
+    profiler_begin(PROFILE_ELABORATION);
 
-    sc_clock clk("clk", 1, SC_SEC);
+    // The loosely-timed mode has no clock, its modules only advance time through annotated delays
+    sc_clock* clock = options->tlm ? nullptr : new sc_clock("clk", 1, SC_SEC);
+    sc_signal<bool> noClock;
+    sc_signal<bool> &clk = clock ? *clock : noClock;
     sc_signal<uint32_t> requestAddr;
     sc_signal<uint32_t> requestData;
     sc_signal<int> requestWE;
+    sc_signal<unsigned> requestSize;
+    sc_signal<int> requestFetch;
+    sc_signal<unsigned> requestStream;
     sc_signal<size_t> resultCycles;
     sc_signal<size_t> resultHits;
     sc_signal<size_t> resultMisses;
@@ -93,24 +114,38 @@ Result run_simulation(int cycles, bool directMapped,  unsigned cacheLines, unsig
         sc_trace(simulationTracefile, requestAddr, "Request Address");
         sc_trace(simulationTracefile, requestData, "Request Data");
         sc_trace(simulationTracefile, requestWE, "Request WE");
+        sc_trace(simulationTracefile, requestSize, "Request Size");
+        sc_trace(simulationTracefile, requestFetch, "Request Fetch");
+        sc_trace(simulationTracefile, requestStream, "Request Stream");
         sc_trace(simulationTracefile, resultCycles, "Result Cycles");
         sc_trace(simulationTracefile, resultMisses, "Result Misses");
         sc_trace(simulationTracefile, resultHits, "Result Hits");
         sc_trace(simulationTracefile, resultPrimitiveGateCount, "Result Primitive Gate Count");
     }
 
-    CACHE_MODULE cache ("cache", cycles, directMapped, cacheLines, cacheLineSize, cacheLatency, memoryLatency, numRequests);
+    CACHE_MODULE cache ("cache", cycles, directMapped, cacheLines, cacheLineSize, cacheLatency, memoryLatency, numRequests,
+                        options, statistics);
     
     // Connnect ports to signals
     cache.clk(clk);
     cache.requestAddr(requestAddr);
     cache.requestWE(requestWE);
     cache.requestData(requestData);
+    cache.requestSize(requestSize);
+    cache.requestFetch(requestFetch);
+    cache.requestStream(requestStream);
     cache.resultCycles(resultCycles);
     cache.resultHits(resultHits);
     cache.resultMisses(resultMisses);
     cache.resultPrimitiveGateCount(resultPrimitiveGateCount);
 
+    // Sockets are bound in every mode, only the loosely-timed one sends transactions through them
+    TLM_MEMORY memory("memory", memoryLatency);
+    TLM_INITIATOR core("core", requests, numRequests, cycles, options->tlmQuantum, options->tlm);
+    core.socket.bind(cache.targetSocket);
+    core.fetchSocket.bind(cache.fetchTargetSocket);
+    cache.memorySocket.bind(memory.socket);
+
     // Simulation: Matrix multiplication, only use for matrix_multiplication.csv
     uint32_t entryMatrixA = 0;
     uint32_t entryMatrixB = 0;
@@ -130,7 +165,140 @@ Result run_simulation(int cycles, bool directMapped,  unsigned cacheLines, unsig
 
     size_t requestIndex = 0;
 
-    for (int cycleCount = 0; cycleCount < cycles; requestIndex++, cycleCount++) {
+    // Warm start from a checkpoint instead of a cold cache and an empty main memory
+    if (options->loadCheckpoint && !cache.load_checkpoint(options->loadCheckpoint)) {
+        fprintf(stderr, "Error loading checkpoint.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Golden model for --verify, checked once per completed request
+    ReferenceMemory* referenceMemory = options->verify ? new ReferenceMemory(CACHE_ADDRESS_LENGTH) : nullptr;
+    if (referenceMemory && options->loadCheckpoint) {
+        referenceMemory->copy_from(*mainMemory);
+    }
+
+    profiler_end(PROFILE_ELABORATION);
+    profiler_begin(PROFILE_SIMULATION);
+
+    // Queued mode: issue up to issueWidth requests per cycle, the module stamps their completion
+    if (options->issueWidth > 0) {
+        for (int cycleCount = 0; cycleCount < cycles; cycleCount++) {
+            if (requestIndex >= numRequests && cache.idle()) {
+                break;
+            }
+            for (unsigned slot = 0; slot < options->issueWidth && requestIndex < numRequests; slot++) {
+                if (!cache.enqueue(requestIndex, requests[requestIndex])) {
+                    break;
+                }
+                requestIndex++;
+            }
+            sc_start(1, SC_SEC);
+        }
+
+        // Requests are accessed in queue order, so the golden model can replay them afterwards
+        for (size_t index = 0; referenceMemory && index < cache.processedRequests; index++) {
+            if (requests[index].we) {
+                referenceMemory->write(requests[index].addr, requests[index].data, requests[index].size);
+            } else {
+                referenceMemory->check(index, requests[index].addr, requests[index].size, cache.requestTimings[index].data, *statistics);
+            }
+        }
+        if (requestIndex < numRequests || !cache.idle()) {
+            cache.resultTemp.cycles = SIZE_MAX - 1;
+        }
+    }
+
+    // Loosely-timed mode: runs until the core has replayed all requests, the cache completes each in one call
+    if (options->tlm) {
+        sc_start();
+        for (size_t index = 0; referenceMemory && index < core.processedRequests; index++) {
+            if (requests[index].we) {
+                referenceMemory->write(requests[index].addr, requests[index].data, requests[index].size);
+            } else {
+                referenceMemory->check(index, requests[index].addr, requests[index].size, core.readData[index], *statistics);
+            }
+        }
+        if (core.processedRequests < numRequests || cache.resultTemp.cycles >= static_cast<size_t>(cycles)) {
+            cache.resultTemp.cycles = SIZE_MAX - 1;
+        }
+    }
+
+    // Sampled mode: the last sampleUnit requests of every sampleInterval units are timed in detail after
+    // sampleWarmup detailed warm-up requests, all other requests only update the cache state
+    if (options->sampleInterval > 0) {
+        size_t unit = options->sampleUnit;
+        size_t period = unit * options->sampleInterval;
+        size_t warmup = min<size_t>(options->sampleWarmup, period - unit);
+        int cycleCount = 0;
+        size_t unitStartCycle = 0;
+        vector<double> cyclesPerRequest;
+
+        for (; requestIndex < numRequests && cycleCount < cycles; requestIndex++) {
+            size_t positionInPeriod = requestIndex % period;
+            size_t measuredStart = period - unit;
+            uint32_t dataRead;
+
+            if (positionInPeriod < measuredStart - warmup) {
+                dataRead = cache.functional_access(requests[requestIndex]);
+            } else {
+                if (positionInPeriod == measuredStart) {
+                    unitStartCycle = resultCycles.read();
+                }
+
+                requestAddr = requests[requestIndex].addr;
+                requestWE = requests[requestIndex].we;
+                requestData = requests[requestIndex].data;
+                requestSize = requests[requestIndex].size;
+                requestFetch = requests[requestIndex].fetch;
+                requestStream = requests[requestIndex].stream;
+                do {
+                    sc_start(1, SC_SEC);
+                    cycleCount++;
+                } while ((cache.waitForCacheLatency.read() || cache.waitForMemoryLatency.read()) && cycleCount < cycles);
+                dataRead = cache.data.read();
+
+                // A unit cut short by the end of the trace is still a valid sample
+                bool unitComplete = positionInPeriod == period - 1 || requestIndex == numRequests - 1;
+                if (positionInPeriod >= measuredStart && unitComplete) {
+                    size_t requestsInUnit = positionInPeriod - measuredStart + 1;
+                    size_t unitCycles = resultCycles.read() - unitStartCycle;
+                    cyclesPerRequest.push_back(static_cast<double>(unitCycles) / requestsInUnit);
+                    statistics->detailedRequests += requestsInUnit;
+                    statistics->detailedCycles += unitCycles;
+                }
+            }
+
+            if (referenceMemory) {
+                if (requests[requestIndex].we) {
+                    referenceMemory->write(requests[requestIndex].addr, requests[requestIndex].data, requests[requestIndex].size);
+                } else {
+                    referenceMemory->check(requestIndex, requests[requestIndex].addr, requests[requestIndex].size, dataRead, *statistics);
+                }
+            }
+        }
+
+        // Extrapolate the mean cycles per request with a 95% confidence interval over the units
+        size_t samples = cyclesPerRequest.size();
+        double mean = 0.0;
+        double variance = 0.0;
+        for (double value : cyclesPerRequest) {
+            mean += value / samples;
+        }
+        for (double value : cyclesPerRequest) {
+            variance += (samples > 1) ? (value - mean) * (value - mean) / (samples - 1) : 0.0;
+        }
+        statistics->sampledUnits = samples;
+        statistics->cyclesConfidenceInterval = 1.96 * sqrt(variance / max<size_t>(samples, 1)) * numRequests;
+
+        if (requestIndex < numRequests) {
+            cache.resultTemp.cycles = SIZE_MAX - 1;
+        } else {
+            cache.resultTemp.cycles = static_cast<size_t>(llround(mean * numRequests));
+        }
+    }
+
+    for (int cycleCount = 0; cycleCount < cycles && options->issueWidth == 0 && options->sampleInterval == 0 && !options->tlm;
+         requestIndex++, cycleCount++) {
         // If all request have been processed, exit the loop
         if (requestIndex >= numRequests) {
             break;
@@ -145,6 +313,9 @@ Result run_simulation(int cycles, bool directMapped,  unsigned cacheLines, unsig
         requestAddr = requests[requestIndex].addr;
         requestWE = requests[requestIndex].we;
         requestData = requests[requestIndex].data;
+        requestSize = requests[requestIndex].size;
+        requestFetch = requests[requestIndex].fetch;
+        requestStream = requests[requestIndex].stream;
         
         // Run simulation for 1 cycle
         sc_start(1, SC_SEC);
@@ -154,7 +325,21 @@ Result run_simulation(int cycles, bool directMapped,  unsigned cacheLines, unsig
             requestIndex--;
             continue;
         }
+
+        if (referenceMemory) {
+            if (requests[requestIndex].we) {
+                referenceMemory->write(requests[requestIndex].addr, requests[requestIndex].data, requests[requestIndex].size);
+            } else {
+                referenceMemory->check(requestIndex, requests[requestIndex].addr, requests[requestIndex].size,
+                                       cache.data.read(), *statistics);
+            }
+        }
         
+        // Other traces run past the end of matrix C, stop checking there instead of indexing out of bounds
+        if (c_i >= MATRIX_SIZE) {
+            continue;
+        }
+
         // Only conduct tests once finished initializing main memory with matrix_multiplication.csv
         if (requests[requestIndex].we) {
             if (isInitializationFinished) {  
@@ -237,14 +422,26 @@ Result run_simulation(int cycles, bool directMapped,  unsigned cacheLines, unsig
     }
 
     // Update result
+    statistics->processedRequests = (options->issueWidth > 0) ? cache.processedRequests
+                                  : (options->tlm ? core.processedRequests : requestIndex);
+    cache.drain();
     result = cache.resultTemp;
+    profiler_end(PROFILE_SIMULATION);
+    profiler_begin(PROFILE_OUTPUT);
+
+    if (options->saveCheckpoint && !cache.save_checkpoint(options->saveCheckpoint)) {
+        fprintf(stderr, "Error writing checkpoint %s.\n", options->saveCheckpoint);
+    }
 
     // Close and free resources
     if (simulationTracefileCreated) {
         sc_close_vcd_trace_file(simulationTracefile);
     }
+    profiler_end(PROFILE_OUTPUT);
     delete mainMemory;
     delete cache.cache;
+    delete referenceMemory;
+    delete clock;
 
     return result;
 }
@@ -0,0 +1,145 @@
+#include <algorithm>
+
+#include "../includes/store_buffer.hpp"
+
+using namespace std;
+
+StoreBuffer::StoreBuffer(unsigned numberOfEntries, uint32_t lineSize, SimulationStatistics* statistics,
+                         function<unsigned(uint32_t address, uint32_t bytes, size_t cycle)> drainLatency)
+    : numberOfEntries(numberOfEntries), lineSize(lineSize), memoryFreeCycle(0), accountedCycle(0), statistics(statistics),
+      drainLatency(drainLatency) {}
+
+void StoreBuffer::account(size_t cycle) {
+    if (cycle > accountedCycle) {
+        statistics->storeBufferOccupancyCycles += entries.size() * (cycle - accountedCycle);
+        accountedCycle = cycle;
+    }
+}
+
+void StoreBuffer::start_drain(size_t cycle) {
+    Entry &oldest = entries.front();
+    oldest.drainedCycle = cycle + drainLatency(oldest.lineAddress, oldest.writtenBytes, cycle);
+    memoryFreeCycle = oldest.drainedCycle;
+}
+
+void StoreBuffer::retire_oldest() {
+    account(entries.front().drainedCycle);
+    statistics->storeBufferDrains++;
+    statistics->storeBufferDrainedBytes += entries.front().writtenBytes;
+    entries.pop_front();
+}
+
+void StoreBuffer::tick(size_t cycle) {
+    while (!entries.empty()) {
+        Entry &oldest = entries.front();
+        // The write is issued in the current cycle, so the DRAM and the bus see it in order with the fills
+        if (oldest.drainedCycle == SIZE_MAX) {
+            if (oldest.readyCycle > cycle || memoryFreeCycle > cycle) {
+                break;
+            }
+            start_drain(cycle);
+        }
+        if (oldest.drainedCycle > cycle) {
+            break;
+        }
+        retire_oldest();
+    }
+    account(cycle);
+}
+
+unsigned StoreBuffer::store(uint32_t address, unsigned size, size_t cycle) {
+    tick(cycle);
+    statistics->storeBufferStores++;
+
+    unsigned stall = 0;
+    bool combined = true;
+    bool full = false;
+    for (uint32_t lineAddress = address - address % lineSize; lineAddress < address + size; lineAddress += lineSize) {
+        // Only the youngest entry of the line can still take bytes, and only until its memory write started
+        Entry* entry = nullptr;
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            if (it->lineAddress == lineAddress) {
+                entry = (it->drainedCycle == SIZE_MAX) ? &*it : nullptr;
+                break;
+            }
+        }
+
+        if (!entry) {
+            combined = false;
+
+            // Full: the store waits until the oldest entry is written, even if that one is still open
+            if (entries.size() == numberOfEntries) {
+                if (entries.front().drainedCycle == SIZE_MAX) {
+                    start_drain(max(cycle + stall, memoryFreeCycle));
+                }
+                stall = entries.front().drainedCycle - cycle;
+                full = true;
+                tick(cycle + stall);
+            }
+
+            // The stores moved on to another line, so the previous tail can drain
+            if (!entries.empty()) {
+                entries.back().readyCycle = min(entries.back().readyCycle, cycle + stall);
+            }
+            entries.push_back({lineAddress, vector<bool>(lineSize, false), 0, SIZE_MAX, SIZE_MAX});
+            entry = &entries.back();
+            statistics->storeBufferPeakOccupancy = max(statistics->storeBufferPeakOccupancy, entries.size());
+        }
+
+        uint32_t first = max(address, lineAddress);
+        uint32_t last = min(address + size, lineAddress + lineSize);
+        for (uint32_t byte = first; byte < last; byte++) {
+            if (!entry->written[byte - lineAddress]) {
+                entry->written[byte - lineAddress] = true;
+                entry->writtenBytes++;
+            }
+        }
+
+        // A completely written line has nothing left to combine
+        if (entry->writtenBytes == lineSize) {
+            entry->readyCycle = min(entry->readyCycle, cycle + stall);
+        }
+    }
+
+    // A store crossing into a second line can find the buffer full twice, it still stalled once
+    statistics->storeBufferCombines += combined ? 1 : 0;
+    statistics->storeBufferFullStalls += full ? 1 : 0;
+    statistics->storeBufferStallCycles += stall;
+    return stall;
+}
+
+bool StoreBuffer::forwards(uint32_t address, unsigned size, size_t cycle) {
+    tick(cycle);
+    for (uint32_t byte = address; byte < address + size; byte++) {
+        uint32_t lineAddress = byte - byte % lineSize;
+        auto buffered = find_if(entries.begin(), entries.end(), [lineAddress, byte](const Entry &entry) {
+            return entry.lineAddress == lineAddress && entry.written[byte - lineAddress];
+        });
+        if (buffered == entries.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t StoreBuffer::drain(size_t cycle) {
+    tick(cycle);
+    if (entries.empty()) {
+        return 0;
+    }
+
+    entries.back().readyCycle = min(entries.back().readyCycle, cycle);
+    size_t lastDrainedCycle = cycle;
+    while (!entries.empty()) {
+        if (entries.front().drainedCycle == SIZE_MAX) {
+            start_drain(max(max(entries.front().readyCycle, cycle), memoryFreeCycle));
+        }
+        lastDrainedCycle = entries.front().drainedCycle;
+        retire_oldest();
+    }
+    return lastDrainedCycle - cycle;
+}
+
+size_t StoreBuffer::occupancy() const {
+    return entries.size();
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+
+#include "../includes/tlm_initiator.hpp"
+
+tlm::tlm_extension_base* StreamExtension::clone() const {
+    return new StreamExtension(*this);
+}
+
+void StreamExtension::copy_from(const tlm::tlm_extension_base &extension) {
+    stream = static_cast<const StreamExtension&>(extension).stream;
+}
+
+TLM_INITIATOR::TLM_INITIATOR(sc_module_name name, Request* requests, size_t numRequests, int cycles, unsigned quantum, bool enabled)
+    : sc_module(name), socket("socket"), fetchSocket("fetchSocket"), requests(requests), numRequests(numRequests), cycles(cycles), processedRequests(0) {
+    tlm_utils::tlm_quantumkeeper::set_global_quantum(CYCLE_TIME * quantum);
+    quantumKeeper.reset();
+
+    // The sockets are bound in the pin-level modes as well, the initiator only runs in the loosely-timed one
+    if (enabled) {
+        readData.resize(numRequests);
+        SC_THREAD(run);
+    }
+}
+
+void TLM_INITIATOR::run() {
+    tlm::tlm_generic_payload transaction;
+    uint8_t span[MAX_ACCESS_SIZE];
+    transaction.set_extension(&streamExtension);
+
+    for (size_t i = 0; i < numRequests; i++) {
+        // Stop issuing once the given cycles have passed, the remaining requests count as not processed
+        if (quantumKeeper.get_current_time() >= CYCLE_TIME * cycles) {
+            break;
+        }
+
+        // The 32-bit write data is repeated over the access as in the pin-level model
+        unsigned size = requests[i].size ? requests[i].size : 4;
+        for (unsigned j = 0; requests[i].we && j < size; j++) {
+            span[j] = static_cast<uint8_t>((requests[i].data >> (8 * (j % 4))) & 0xFF);
+        }
+
+        transaction.set_command(requests[i].we ? tlm::TLM_WRITE_COMMAND : tlm::TLM_READ_COMMAND);
+        transaction.set_address(requests[i].addr);
+        transaction.set_data_ptr(span);
+        transaction.set_data_length(size);
+        transaction.set_streaming_width(size);
+        transaction.set_byte_enable_ptr(nullptr);
+        transaction.set_dmi_allowed(false);
+        transaction.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+        streamExtension.stream = requests[i].stream;
+
+        sc_time delay = quantumKeeper.get_local_time();
+        if (requests[i].fetch) {
+            fetchSocket->b_transport(transaction, delay);
+        } else {
+            socket->b_transport(transaction, delay);
+        }
+        quantumKeeper.set(delay);
+
+        if (transaction.is_response_error()) {
+            cerr << "Error: Request " << i << " failed with " << transaction.get_response_string() << endl;
+            break;
+        }
+        if (!requests[i].we) {
+            uint32_t dataRead = 0;
+            for (unsigned j = 0; j < size && j < 4; j++) {
+                dataRead |= static_cast<uint32_t>(span[j]) << (8 * j);
+            }
+            readData[i] = dataRead;
+        }
+        processedRequests++;
+
+        if (quantumKeeper.need_sync()) {
+            quantumKeeper.sync();
+        }
+    }
+    quantumKeeper.sync();
+
+    // The extension is a member, the payload must not free it
+    transaction.clear_extension(&streamExtension);
+}
@@ -0,0 +1,43 @@
+#include <cstring>
+
+#include "../includes/tlm_memory.hpp"
+
+TLM_MEMORY::TLM_MEMORY(sc_module_name name, unsigned memoryLatency) : sc_module(name), socket("socket"), memoryLatency(memoryLatency) {
+    socket.register_b_transport(this, &TLM_MEMORY::b_transport);
+    socket.register_get_direct_mem_ptr(this, &TLM_MEMORY::get_direct_mem_ptr);
+}
+
+void TLM_MEMORY::b_transport(tlm::tlm_generic_payload &transaction, sc_time &delay) {
+    uint64_t address = transaction.get_address();
+    uint32_t length = transaction.get_data_length();
+    uint8_t* data = transaction.get_data_ptr();
+
+    if (address + length > mainMemory->size()) {
+        transaction.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+        return;
+    }
+    if (transaction.get_byte_enable_ptr() || transaction.get_streaming_width() < length) {
+        transaction.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+        return;
+    }
+
+    if (transaction.is_write()) {
+        mainMemory->write_span(address, data, length);
+    } else if (transaction.is_read()) {
+        memcpy(data, mainMemory->direct_pointer() + address, length);
+    }
+
+    delay += CYCLE_TIME * memoryLatency;
+    transaction.set_dmi_allowed(true);
+    transaction.set_response_status(tlm::TLM_OK_RESPONSE);
+}
+
+bool TLM_MEMORY::get_direct_mem_ptr(tlm::tlm_generic_payload &transaction, tlm::tlm_dmi &dmi) {
+    // The pointer is only handed out for reading, it aliases the storage of the global main memory
+    dmi.set_dmi_ptr(const_cast<uint8_t*>(mainMemory->direct_pointer()));
+    dmi.set_start_address(0);
+    dmi.set_end_address(mainMemory->size() - 1);
+    dmi.set_read_latency(CYCLE_TIME * memoryLatency);
+    dmi.allow_read();
+    return true;
+}
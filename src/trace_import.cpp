@@ -0,0 +1,235 @@
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../includes/trace_import.hpp"
+#include "../includes/cache_module.hpp"
+
+using namespace std;
+
+// Layout of ChampSim's input_instr, all fields little-endian
+#define BINARY_RECORD_SIZE 64
+#define BINARY_IP_OFFSET 0
+#define BINARY_DESTINATION_MEMORY_OFFSET 16
+#define BINARY_DESTINATION_OPERANDS 2
+#define BINARY_SOURCE_MEMORY_OFFSET 32
+#define BINARY_SOURCE_OPERANDS 4
+
+// Appends requests while importing, counting only if there is no request array. Instruction fetches
+// are dropped unless they are wanted.
+struct RequestSink {
+    Request* requests;
+    size_t capacity;
+    size_t count;
+    bool fetches;
+
+    void add(bool write, uint64_t address, unsigned size, bool fetch = false) {
+        if (fetch && !fetches) {
+            return;
+        }
+        if (requests && count < capacity) {
+            // Access widths are rounded up to a power of two, as the cache only handles those
+            unsigned width = 1;
+            while (width < size && width < MAX_ACCESS_SIZE) {
+                width <<= 1;
+            }
+
+            // Addresses are folded into the simulated address space, keeping the access inside it
+            uint32_t addressSpace = 1u << CACHE_ADDRESS_LENGTH;
+            uint32_t folded = static_cast<uint32_t>(address) & (addressSpace - 1);
+            folded = folded + width > addressSpace ? addressSpace - width : folded;
+
+            // The request number as data keeps the written values apart for --verify
+            requests[count].we = write ? 1 : 0;
+            requests[count].addr = folded;
+            requests[count].data = write ? static_cast<uint32_t>(count) : 0;
+            requests[count].size = width == 4 ? 0 : width;
+            requests[count].fetch = fetch ? 1 : 0;
+            requests[count].stream = 0;
+        }
+        count++;
+    }
+};
+
+static const char* skip_blanks(const char* position, const char* end) {
+    while (position < end && (*position == ' ' || *position == '\t' || *position == '\r')) {
+        position++;
+    }
+    return position;
+}
+
+// Parses hex digits with an optional 0x prefix, returns nullptr if there are none
+static const char* parse_hex(const char* position, const char* end, uint64_t &value) {
+    if (end - position > 2 && position[0] == '0' && (position[1] == 'x' || position[1] == 'X')) {
+        position += 2;
+    }
+    const char* start = position;
+    value = 0;
+    for (; position < end; position++) {
+        char c = *position;
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            break;
+        }
+        value = (value << 4) | digit;
+    }
+    return position == start ? nullptr : position;
+}
+
+static const char* parse_decimal(const char* position, const char* end, uint64_t &value) {
+    const char* start = position;
+    value = 0;
+    for (; position < end && *position >= '0' && *position <= '9'; position++) {
+        value = value * 10 + (*position - '0');
+    }
+    return position == start ? nullptr : position;
+}
+
+// Dinero labels: 0 read, 1 write, 2 instruction fetch, 3 escape, 4 cache flush. Escapes and flushes are skipped.
+static bool import_din_line(const char* line, const char* end, RequestSink &sink) {
+    uint64_t label, address, size = 4;
+    const char* position = parse_decimal(skip_blanks(line, end), end, label);
+    if (!position || label > 4) {
+        return false;
+    }
+    position = parse_hex(skip_blanks(position, end), end, address);
+    if (!position) {
+        return false;
+    }
+    position = skip_blanks(position, end);
+    if (position < end && !(position = parse_hex(position, end, size))) {
+        return false;
+    }
+    if (label <= 2) {
+        sink.add(label == 1, address, static_cast<unsigned>(size), label == 2);
+    }
+    return true;
+}
+
+// Lackey lines are 'I  <addr>,<size>' for instruction fetches and ' L|S|M <addr>,<size>' for data,
+// a modify is a load followed by a store. Valgrind's own '==<pid>==' messages are skipped.
+static bool import_lackey_line(const char* line, const char* end, RequestSink &sink) {
+    if (end - line >= 2 && line[0] == '=' && line[1] == '=') {
+        return true;
+    }
+    const char* position = skip_blanks(line, end);
+    if (position == end) {
+        return false;
+    }
+    char kind = *position++;
+    uint64_t address, size;
+    position = parse_hex(skip_blanks(position, end), end, address);
+    if (!position || position == end || *position != ',' || !parse_decimal(position + 1, end, size)) {
+        return false;
+    }
+
+    switch (kind) {
+    case 'I':
+        sink.add(false, address, static_cast<unsigned>(size), true);
+        break;
+    case 'L':
+        sink.add(false, address, static_cast<unsigned>(size));
+        break;
+    case 'S':
+        sink.add(true, address, static_cast<unsigned>(size));
+        break;
+    case 'M':
+        sink.add(false, address, static_cast<unsigned>(size));
+        sink.add(true, address, static_cast<unsigned>(size));
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static uint64_t load_little_endian(const uint8_t* bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+// Every instruction is fetched, then reads its source memory operands and writes its destination operands,
+// unused operands are 0. The records carry no access width, so the default of 4 Byte is used.
+static bool import_binary(const uint8_t* data, size_t size, RequestSink &sink) {
+    if (size % BINARY_RECORD_SIZE != 0) {
+        cerr << "Error: Binary trace size is not a multiple of " << BINARY_RECORD_SIZE << " Byte" << endl;
+        return false;
+    }
+    for (const uint8_t* record = data; record < data + size; record += BINARY_RECORD_SIZE) {
+        sink.add(false, load_little_endian(record + BINARY_IP_OFFSET), 4, true);
+        for (int i = 0; i < BINARY_SOURCE_OPERANDS; i++) {
+            uint64_t address = load_little_endian(record + BINARY_SOURCE_MEMORY_OFFSET + 8 * i);
+            if (address) {
+                sink.add(false, address, 4);
+            }
+        }
+        for (int i = 0; i < BINARY_DESTINATION_OPERANDS; i++) {
+            uint64_t address = load_little_endian(record + BINARY_DESTINATION_MEMORY_OFFSET + 8 * i);
+            if (address) {
+                sink.add(true, address, 4);
+            }
+        }
+    }
+    return true;
+}
+
+static bool import_text(const char* data, size_t size, enum TraceFormat format, RequestSink &sink) {
+    const char* end = data + size;
+    size_t lineNumber = 0;
+    for (const char* line = data; line < end; ) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        lineEnd = lineEnd ? lineEnd : end;
+        lineNumber++;
+
+        if (skip_blanks(line, lineEnd) != lineEnd) {
+            bool parsed = format == TRACE_DIN ? import_din_line(line, lineEnd, sink) : import_lackey_line(line, lineEnd, sink);
+            if (!parsed) {
+                cerr << "Error in trace line " << lineNumber << ": " << string(line, lineEnd - line) << endl;
+                return false;
+            }
+        }
+        line = lineEnd + 1;
+    }
+    return true;
+}
+
+long import_trace(const char* path, enum TraceFormat format, Request requests[], size_t capacity, int fetches) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        cerr << "Error: Can't open trace " << path << endl;
+        return -1;
+    }
+
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0 || !S_ISREG(fileInfo.st_mode) || fileInfo.st_size <= 0) {
+        cerr << "Error: Can't read trace " << path << endl;
+        close(fd);
+        return -1;
+    }
+    size_t size = fileInfo.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        cerr << "Error: Can't map trace " << path << endl;
+        return -1;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    RequestSink sink = {requests, capacity, 0, fetches != 0};
+    bool imported = format == TRACE_BINARY ? import_binary(static_cast<const uint8_t*>(mapping), size, sink)
+                                           : import_text(static_cast<const char*>(mapping), size, format, sink);
+    munmap(mapping, size);
+    return imported ? static_cast<long>(sink.count) : -1;
+}
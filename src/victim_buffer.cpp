@@ -0,0 +1,79 @@
+#include <utility>
+#include <cstring>
+
+#include "../includes/victim_buffer.hpp"
+
+using namespace std;
+
+VictimBuffer::VictimBuffer(unsigned numberOfEntries, uint32_t lineSize, Arena &arena) : useCounter(0), lineSize(lineSize) {
+    entries.resize(numberOfEntries);
+    uint8_t* storage = static_cast<uint8_t*>(arena.allocate(numberOfEntries * lineSize));
+    for (unsigned i = 0; i < numberOfEntries; i++) {
+        Entry &entry = entries[i];
+        entry.lineNumber = 0;
+        entry.data = &storage[i * lineSize];
+        entry.validSectors = 0;
+        entry.valid = false;
+        entry.lastUse = 0;
+    }
+}
+
+bool VictimBuffer::swap(uint32_t lineNumber, uint8_t* &lineData, uint64_t &validSectors, bool evictedValid, uint32_t evictedLineNumber) {
+    for (auto &entry : entries) {
+        if (!entry.valid || entry.lineNumber != lineNumber) {
+            continue;
+        }
+        std::swap(entry.data, lineData);
+        std::swap(entry.validSectors, validSectors);
+        entry.lineNumber = evictedLineNumber;
+        entry.valid = evictedValid;
+        entry.lastUse = ++useCounter;
+        return true;
+    }
+    return false;
+}
+
+void VictimBuffer::insert(uint32_t lineNumber, uint8_t* &lineData, uint64_t validSectors) {
+    Entry* victim = &entries[0];
+    for (auto &entry : entries) {
+        if (!entry.valid) {
+            victim = &entry;
+            break;
+        }
+        if (entry.lastUse < victim->lastUse) {
+            victim = &entry;
+        }
+    }
+    std::swap(victim->data, lineData);
+    victim->validSectors = validSectors;
+    victim->lineNumber = lineNumber;
+    victim->valid = true;
+    victim->lastUse = ++useCounter;
+}
+
+void VictimBuffer::save_state(CheckpointWriter &writer) {
+    writer.put(static_cast<uint64_t>(useCounter));
+    for (auto &entry : entries) {
+        writer.put(entry.lineNumber);
+        writer.put(entry.validSectors);
+        writer.put(static_cast<uint8_t>(entry.valid));
+        writer.put(static_cast<uint64_t>(entry.lastUse));
+        writer.put_bytes(entry.data, lineSize);
+    }
+}
+
+bool VictimBuffer::load_state(CheckpointReader &reader) {
+    useCounter = reader.get<uint64_t>();
+    for (auto &entry : entries) {
+        entry.lineNumber = reader.get<uint32_t>();
+        entry.validSectors = reader.get<uint64_t>();
+        entry.valid = reader.get<uint8_t>() != 0;
+        entry.lastUse = reader.get<uint64_t>();
+        const uint8_t* lineData = reader.get_bytes(lineSize);
+        if (!lineData) {
+            return false;
+        }
+        memcpy(entry.data, lineData, lineSize);
+    }
+    return reader.ok();
+}